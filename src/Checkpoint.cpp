@@ -0,0 +1,189 @@
+/*
+ * Checkpoint.cpp
+ * Saving and restoring the routing state, so that a long run can be continued
+ * after a timeout or preemption.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "SimpleGR.h"
+
+namespace {
+const char checkpointMagic[8] = { 'S', 'G', 'R', 'C', 'K', 'P', 'T', '1' };
+// bump whenever the layout below changes
+const uint32_t checkpointVersion = 1;
+
+// File layout, sections follow each other without padding. Edges are stored by
+// SimpleGR::rowMajorEdgeId, so a checkpoint does not depend on params.tileSize.
+//   CheckpointHeader
+//   CostType  historyCost of every edge
+//   uint8_t   usage of every edge, used to validate the restored routes
+//   uint32_t  number of route edges of every net
+//   IdType    route edges of all nets, net after net
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t stage, rrrIteration;
+    uint32_t numNets, numEdges;
+    uint32_t totalOverflow, overfullEdges, totalSegments, totalVias;
+    uint64_t numRouteEdges;
+};
+
+const char *stageName(SimpleGR::RouteStage stage)
+{
+    switch (stage) {
+    case SimpleGR::StageNone: return "before routing";
+    case SimpleGR::StageInitial: return "after initial routing";
+    case SimpleGR::StageRRR: return "after rip-up and re-route";
+    case SimpleGR::StageGreedy: return "after greedy improvement";
+    }
+    return "";
+}
+}// namespace
+
+//@brief: save the complete routing state to params.checkpointFile, if checkpoints
+//        are enabled. The file is written under a temporary name first, so an
+//        interrupted write never destroys the previous checkpoint.
+void SimpleGR::saveCheckpoint(void)
+{
+    if (params.checkpointFile.empty()) return;
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+    header.version = checkpointVersion;
+    header.stage = stage;
+    header.rrrIteration = rrrIteration;
+    header.numNets = static_cast<uint32_t>(grNetArr.size());
+    header.numEdges = static_cast<uint32_t>(grEdgeArr.size());
+    header.totalOverflow = totalOverflow;
+    header.overfullEdges = overfullEdges;
+    header.totalSegments = totalSegments;
+    header.totalVias = totalVias;
+
+    // gather everything into flat arrays, so that the file is written in a few large chunks
+    vector<CostType> history(grEdgeArr.size());
+    vector<uint8_t> usage(grEdgeArr.size());
+    for (const Edge &edge : grEdgeArr) {
+        history[rowMajorEdgeId(edge)] = edge.historyCost;
+        usage[rowMajorEdgeId(edge)] = static_cast<uint8_t>(edge.usage);
+    }
+    vector<uint32_t> routeLens(grNetArr.size());
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        routeLens[i] = grNetArr[i].numSegments + grNetArr[i].numVias;
+        header.numRouteEdges += routeLens[i];
+    }
+    vector<IdType> routeEdges;
+    routeEdges.reserve(header.numRouteEdges);
+    for (const Net &net : grNetArr) {
+        for (const RouteRun &run : net.runs) {
+            for (IdType i = 0; i < run.length; ++i) { routeEdges.push_back(run.first + i); }
+        }
+    }
+
+    const string tmpFile = params.checkpointFile + ".tmp";
+    ofstream out(tmpFile.c_str(), ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(history.data()),
+        static_cast<streamsize>(history.size() * sizeof(CostType)));
+    out.write(reinterpret_cast<const char *>(usage.data()), static_cast<streamsize>(usage.size()));
+    out.write(reinterpret_cast<const char *>(routeLens.data()), static_cast<streamsize>(routeLens.size() * 4));
+    out.write(reinterpret_cast<const char *>(routeEdges.data()),
+        static_cast<streamsize>(routeEdges.size() * sizeof(IdType)));
+    out.close();
+
+    if (!out.good() || rename(tmpFile.c_str(), params.checkpointFile.c_str()) != 0) {
+        remove(tmpFile.c_str());
+        cout << "Warning: could not write checkpoint `" << params.checkpointFile << "'" << endl;
+        return;
+    }
+    cout << "Saved checkpoint `" << params.checkpointFile << "' " << stageName(stage);
+    if (stage == StageInitial && rrrIteration > 1) { cout << ", RRR iteration " << rrrIteration - 1; }
+    cout << endl;
+}
+
+//@brief: restore the routing state saved by saveCheckpoint from params.resumeFile.
+//        Routes are committed through addSegment, so edge usage and the routing
+//        stats are rebuilt, and then checked against the saved values.
+//@ret:   false if no resume file was given
+bool SimpleGR::loadCheckpoint(void)
+{
+    if (params.resumeFile.empty()) return false;
+
+    MappedFile file;
+    if (!file.open(params.resumeFile)) {
+        throw InputError("Error: Could not open `" + params.resumeFile + "' for reading");
+    }
+    cout << "Resuming from `" << params.resumeFile << "' ..." << endl;
+
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        throw InputError("Error: `" + params.resumeFile + "' is not a checkpoint");
+    }
+    memcpy(&header, file.begin(), sizeof(header));
+    if (memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0 || header.version != checkpointVersion) {
+        throw InputError("Error: `" + params.resumeFile + "' is not a checkpoint of this SimpleGR version");
+    }
+    if (header.numNets != grNetArr.size() || header.numEdges != grEdgeArr.size()) {
+        throw InputError("Error: `" + params.resumeFile + "' was saved for a different design");
+    }
+    const size_t expectedSize = sizeof(header) + header.numEdges * (sizeof(CostType) + 1) + header.numNets * 4
+                                + header.numRouteEdges * sizeof(IdType);
+    if (file.size() != expectedSize) {
+        throw InputError("Error: `" + params.resumeFile + "' is truncated");
+    }
+
+    const char *pos = file.begin() + sizeof(header);
+    vector<CostType> history(header.numEdges);
+    memcpy(history.data(), pos, history.size() * sizeof(CostType));
+    pos += history.size() * sizeof(CostType);
+    const uint8_t *usage = reinterpret_cast<const uint8_t *>(pos);
+    pos += header.numEdges;
+    vector<uint32_t> routeLens(header.numNets);
+    memcpy(routeLens.data(), pos, routeLens.size() * 4);
+    pos += routeLens.size() * 4;
+    vector<IdType> routeEdges(header.numRouteEdges);
+    memcpy(routeEdges.data(), pos, routeEdges.size() * sizeof(IdType));
+    uint64_t numRouteEdges = 0;
+    for (uint32_t len : routeLens) { numRouteEdges += len; }
+    if (numRouteEdges != header.numRouteEdges) {
+        throw InputError("Error: `" + params.resumeFile + "' has route lengths that do not add up");
+    }
+
+    for (IdType i = 0; i < grEdgeArr.size(); ++i) { grEdgeArr[edgeOfRowMajorId(i)].historyCost = history[i]; }
+
+    size_t next = 0;
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        Net &net = grNetArr[i];
+        for (uint32_t j = 0; j < routeLens[i]; ++j) {
+            const IdType edgeId = routeEdges[next++];
+            if (edgeId >= grEdgeArr.size()) {
+                throw InputError("Error: `" + params.resumeFile + "' has an invalid route for net " + to_string(i));
+            }
+            addSegment(net, grEdgeArr[edgeOfRowMajorId(edgeId)]);
+        }
+        net.routed = routeLens[i] > 0;
+    }
+
+    for (IdType i = 0; i < grEdgeArr.size(); ++i) {
+        if (grEdgeArr[edgeOfRowMajorId(i)].usage != usage[i]) {
+            throw InputError("Error: restored usage of edge " + to_string(i) + " does not match `" + params.resumeFile
+                             + "'");
+        }
+    }
+    if (totalOverflow != header.totalOverflow || overfullEdges != header.overfullEdges
+        || totalSegments != header.totalSegments || totalVias != header.totalVias) {
+        throw InputError("Error: restored routing stats do not match `" + params.resumeFile + "'");
+    }
+
+    stage = static_cast<RouteStage>(header.stage);
+    rrrIteration = header.rrrIteration;
+    cout << "Resumed " << stageName(stage);
+    if (stage == StageInitial && rrrIteration > 1) { cout << ", RRR iteration " << rrrIteration - 1; }
+    cout << endl;
+    return true;
+}
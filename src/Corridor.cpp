@@ -0,0 +1,180 @@
+/*
+ * Corridor.cpp
+ * Coarse-to-fine routing of long nets. The grid is coarsened into tiles of
+ * k x k gcells; the capacity and usage of the boundary between two tiles are
+ * the sums over the fine edges crossing it. A net is routed over the tiles
+ * first, and the fine maze search is then confined to the tiles of that coarse
+ * route, its corridor, which grows when the search fails.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+#include "SimpleGR.h"
+
+namespace {
+// nets whose pins are fewer tiles apart are searched on the fine grid only
+const CoordType corridorMinTiles = 3;
+}// namespace
+
+//@brief: build the coarse grid of params.coarsen x params.coarsen gcell tiles
+//        from the current capacities and routes. Does nothing for factors
+//        below 2. useEdge and releaseEdge keep the usages up to date.
+void SimpleGR::buildCoarseGrid(void)
+{
+    coarse = CoarseGrid();
+    if (params.coarsen < 2) return;
+
+    const CoordType k = params.coarsen;
+    coarse.factor = k;
+    coarse.sizeX = (gcellArrSzX + k - 1) / k;
+    coarse.sizeY = (gcellArrSzY + k - 1) / k;
+    const size_t numTiles = static_cast<size_t>(coarse.sizeX) * coarse.sizeY;
+    coarse.horizCap.assign(numTiles, 0);
+    coarse.horizUsage.assign(numTiles, 0);
+    coarse.vertCap.assign(numTiles, 0);
+    coarse.vertUsage.assign(numTiles, 0);
+    for (const Edge &edge : grEdgeArr) {
+        const IdType boundary = coarseBoundary(edge);
+        if (boundary == NULLID) continue;
+        vector<uint32_t> &caps = (edge.type == HORIZ) ? coarse.horizCap : coarse.vertCap;
+        vector<uint32_t> &usages = (edge.type == HORIZ) ? coarse.horizUsage : coarse.vertUsage;
+        caps[boundary] += edge.capacity;
+        usages[boundary] += edge.usage;
+    }
+    coarse.dist.resize(numTiles);
+    coarse.parent.resize(numTiles);
+    coarse.visited.assign(numTiles, 0);
+    coarse.corridor.assign(numTiles, 0);
+
+    cout << "coarse grid of " << coarse.sizeX << " x " << coarse.sizeY << " tiles of " << k << " x " << k
+         << " gcells" << endl;
+}
+
+//@brief: the tile boundary the fine wire `edge' crosses
+//@ret:   the index of the tile left of (below) it in CoarseGrid::horizCap (vertCap),
+//        or NULLID for vias and edges inside a tile
+IdType SimpleGR::coarseBoundary(const Edge &edge) const
+{
+    // buildGrid puts the lower gcell of an edge first
+    const GCell &gcell = *edge.gcell1;
+    const CoordType k = coarse.factor;
+    if (edge.type == HORIZ && (gcell.x + 1) % k == 0 && gcell.x + 1 < gcellArrSzX) {
+        return (gcell.y / k) * coarse.sizeX + gcell.x / k;
+    }
+    if (edge.type == VERT && (gcell.y + 1) % k == 0 && gcell.y + 1 < gcellArrSzY) {
+        return (gcell.y / k) * coarse.sizeX + gcell.x / k;
+    }
+    return NULLID;
+}
+
+//@brief: add `demand' to the usage of the tile boundary `edge' crosses, if any
+void SimpleGR::updateCoarseUsage(const Edge &edge, int demand)
+{
+    const IdType boundary = coarseBoundary(edge);
+    if (boundary == NULLID) return;
+    vector<uint32_t> &usages = (edge.type == HORIZ) ? coarse.horizUsage : coarse.vertUsage;
+    usages[boundary] = static_cast<uint32_t>(static_cast<int>(usages[boundary]) + demand);
+}
+
+//@brief: stamp the tiles of the corridor of `net' into CoarseGrid::corridor: the
+//        tiles within `widen' tiles of its coarse route. The route is found by
+//        an A* search over the tiles when `widen' is 0 and reused for wider
+//        corridors. The cost of crossing a boundary grows with its congestion
+//        like the DLM cost does.
+//@ret:   false if there is no coarse grid, the net is short or no coarse route
+//        exists, the fine search is not confined then
+bool SimpleGR::markCorridor(const Net &net, CoordType widen)
+{
+    if (coarse.factor == 0) return false;
+    const CoordType k = coarse.factor;
+    const CoordType sx = net.gCellOne.x / k, sy = net.gCellOne.y / k;
+    const CoordType tx = net.gCellTwo.x / k, ty = net.gCellTwo.y / k;
+    if (max(sx, tx) - min(sx, tx) + max(sy, ty) - min(sy, ty) < corridorMinTiles) return false;
+
+    if (widen == 0) {
+        const IdType source = sy * coarse.sizeX + sx, target = ty * coarse.sizeX + tx;
+        if (++coarse.visitStamp == 0) {
+            fill(coarse.visited.begin(), coarse.visited.end(), 0);
+            coarse.visitStamp = 1;
+        }
+        // a step costs at least k wires, which makes the heuristic admissible
+        auto heuristic = [&](IdType tile) {
+            const CoordType x = tile % coarse.sizeX, y = tile / coarse.sizeX;
+            return edgeBase * static_cast<CostType>(k * (max(x, tx) - min(x, tx) + max(y, ty) - min(y, ty)));
+        };
+        auto stepCost = [&](uint32_t cap, uint32_t usage, CapType demand) {
+            const CostType ratio = static_cast<CostType>(usage + demand) / static_cast<CostType>(cap);
+            const CostType congestion = ratio > 1.f ? min(powMax, powf(powBase, ratio - 1.f)) : ratio;
+            return static_cast<CostType>(k) * (edgeBase + congestion);
+        };
+        const CapType horizDemand = minWidths[0] + minSpacings[0];
+        const CapType vertDemand = minWidths[1] + minSpacings[1];
+
+        typedef pair<CostType, IdType> Entry;
+        priority_queue<Entry, vector<Entry>, greater<Entry>> heap;
+        coarse.visited[source] = coarse.visitStamp;
+        coarse.dist[source] = 0.;
+        coarse.parent[source] = NULLID;
+        heap.push(Entry(heuristic(source), source));
+        bool found = false;
+        while (!heap.empty()) {
+            const Entry top = heap.top();
+            heap.pop();
+            const IdType tile = top.second;
+            if (tile == target) {
+                found = true;
+                break;
+            }
+            if (top.first > coarse.dist[tile] + heuristic(tile)) continue;
+
+            const CoordType x = tile % coarse.sizeX, y = tile / coarse.sizeX;
+            auto relax = [&](IdType next, uint32_t cap, uint32_t usage, CapType demand) {
+                if (cap == 0) return;
+                const CostType dist = coarse.dist[tile] + stepCost(cap, usage, demand);
+                if (coarse.visited[next] == coarse.visitStamp && dist >= coarse.dist[next]) return;
+                coarse.visited[next] = coarse.visitStamp;
+                coarse.dist[next] = dist;
+                coarse.parent[next] = tile;
+                heap.push(Entry(dist + heuristic(next), next));
+            };
+            if (x + 1 < coarse.sizeX) relax(tile + 1, coarse.horizCap[tile], coarse.horizUsage[tile], horizDemand);
+            if (x > 0) relax(tile - 1, coarse.horizCap[tile - 1], coarse.horizUsage[tile - 1], horizDemand);
+            if (y + 1 < coarse.sizeY) {
+                relax(tile + coarse.sizeX, coarse.vertCap[tile], coarse.vertUsage[tile], vertDemand);
+            }
+            if (y > 0) {
+                const IdType below = tile - coarse.sizeX;
+                relax(below, coarse.vertCap[below], coarse.vertUsage[below], vertDemand);
+            }
+        }
+        if (!found) return false;
+
+        coarse.path.clear();
+        for (IdType tile = target; tile != NULLID; tile = coarse.parent[tile]) { coarse.path.push_back(tile); }
+    }
+
+    if (++coarse.corridorStamp == 0) {
+        fill(coarse.corridor.begin(), coarse.corridor.end(), 0);
+        coarse.corridorStamp = 1;
+    }
+    CoordType lowX = coarse.sizeX, lowY = coarse.sizeY, highX = 0, highY = 0;
+    for (IdType tile : coarse.path) {
+        const CoordType x = tile % coarse.sizeX, y = tile / coarse.sizeX;
+        const CoordType x0 = x > widen ? x - widen : 0, x1 = min(x + widen, coarse.sizeX - 1);
+        const CoordType y0 = y > widen ? y - widen : 0, y1 = min(y + widen, coarse.sizeY - 1);
+        lowX = min(lowX, x0);
+        lowY = min(lowY, y0);
+        highX = max(highX, x1);
+        highY = max(highY, y1);
+        for (CoordType j = y0; j <= y1; ++j) {
+            for (CoordType i = x0; i <= x1; ++i) { coarse.corridor[j * coarse.sizeX + i] = coarse.corridorStamp; }
+        }
+    }
+    coarse.corridorLow = Point(lowX * k, lowY * k, 0);
+    coarse.corridorHigh = Point(min((highX + 1) * k, gcellArrSzX) - 1, min((highY + 1) * k, gcellArrSzY) - 1, 0);
+    return true;
+}
@@ -0,0 +1,300 @@
+/*
+ * DesignCache.cpp
+ * Binary snapshot of a parsed design. The snapshot is memory mapped on load and
+ * its arrays are used in place, so starting from it costs little more than
+ * building the grid.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <thread>
+
+#include "SimpleGR.h"
+
+namespace {
+const char designCacheMagic[8] = { 'S', 'G', 'R', 'C', 'A', 'C', 'H', 'E' };
+// bump whenever the layout below changes
+const uint32_t designCacheVersion = 2;
+
+// File layout, every section starts on an 8 byte boundary:
+//   DesignCacheHeader
+//   uint32_t    layer values: vertCaps, horizCaps, minWidths, minSpacings, viaSpacings
+//   uint8_t     capacity of every edge, after the capacity adjustments, by rowMajorEdgeId
+//   CachedNet   routable nets, in net id order
+//   uint64_t    name offsets, numNames + 1 entries. Names of routable nets come
+//               first (in net id order), then the names of unroutable nets
+//   char        name bytes
+struct DesignCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t gcellArrSzX, gcellArrSzY, numLayers;
+    uint32_t minX, minY, gcellWidth, gcellHeight;
+    uint32_t numDesignNets, numNets, numNames, numEdges;
+    // the text design the cache was built from: its size, modification time and
+    // a hash of its contents, see designStamp
+    uint64_t inputSize, inputMtimeSec, inputMtimeNsec, inputHash;
+    uint64_t layerOffset, capOffset, netOffset, nameOffsetsOffset, namesOffset, fileSize;
+};
+
+struct CachedNet
+{
+    CoordType x1, y1, z1, x2, y2, z2;
+    IdType dbId;
+};
+
+uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+string cacheFileName(const string &designFile) { return designFile + ".grcache"; }
+
+// A 64-bit hash of `size' bytes, taken 8 bytes at a time. It only has to tell
+// an edited design from the one the cache was built from.
+uint64_t hashBytes(const char *data, size_t size)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < size; ++i) { h = (h ^ static_cast<unsigned char>(data[i])) * prime; }
+    return h;
+}
+
+// Fills the input fields of `header' from the design file
+bool designStamp(const string &designFile, DesignCacheHeader &header)
+{
+    struct stat designStat;
+    MappedFile design;
+    if (stat(designFile.c_str(), &designStat) != 0 || !design.open(designFile)) return false;
+    header.inputSize = static_cast<uint64_t>(designStat.st_size);
+    header.inputMtimeSec = static_cast<uint64_t>(designStat.st_mtim.tv_sec);
+    header.inputMtimeNsec = static_cast<uint64_t>(designStat.st_mtim.tv_nsec);
+    header.inputHash = hashBytes(design.begin(), design.size());
+    return true;
+}
+
+// Checks that the sections of the cache lie within the file, so that the arrays
+// mapped from them cannot be read past its end
+bool sectionsInBounds(const MappedFile &cache)
+{
+    const DesignCacheHeader &header = *reinterpret_cast<const DesignCacheHeader *>(cache.begin());
+    const uint64_t fileSize = header.fileSize;
+    auto inBounds = [fileSize](uint64_t offset, uint64_t bytes) {
+        return offset % 8 == 0 && offset >= sizeof(DesignCacheHeader) && offset <= fileSize
+               && bytes <= fileSize - offset;
+    };
+    if (header.numLayers == 0 || header.numLayers > 255 || header.numNets > header.numNames) return false;
+    if (!inBounds(header.layerOffset, 5 * uint64_t(header.numLayers) * sizeof(uint32_t))
+        || !inBounds(header.capOffset, header.numEdges)
+        || !inBounds(header.netOffset, header.numNets * sizeof(CachedNet))
+        || !inBounds(header.nameOffsetsOffset, (header.numNames + uint64_t(1)) * sizeof(uint64_t))
+        || !inBounds(header.namesOffset, 0)) {
+        return false;
+    }
+
+    // the names are stored back to back, their offsets only grow
+    const uint64_t *nameOffsets = reinterpret_cast<const uint64_t *>(cache.begin() + header.nameOffsetsOffset);
+    if (nameOffsets[0] != 0) return false;
+    for (uint32_t i = 0; i < header.numNames; ++i) {
+        if (nameOffsets[i + 1] < nameOffsets[i]) return false;
+    }
+    return inBounds(header.namesOffset, nameOffsets[header.numNames]);
+}
+
+// Returns the mapped cache if it exists, was written by this version, and was
+// built from the design as it is now: same size, modification time and contents
+bool openCache(const string &designFile, MappedFile &cache)
+{
+    DesignCacheHeader input;
+    if (!cache.open(cacheFileName(designFile)) || cache.size() < sizeof(DesignCacheHeader)) return false;
+    if (!designStamp(designFile, input)) return false;
+
+    const DesignCacheHeader &header = *reinterpret_cast<const DesignCacheHeader *>(cache.begin());
+    return memcmp(header.magic, designCacheMagic, sizeof(designCacheMagic)) == 0
+           && header.version == designCacheVersion && header.fileSize == cache.size()
+           && header.inputSize == input.inputSize && header.inputMtimeSec == input.inputMtimeSec
+           && header.inputMtimeNsec == input.inputMtimeNsec && header.inputHash == input.inputHash
+           && sectionsInBounds(cache);
+}
+}// namespace
+
+//@brief: load the design from its binary cache if there is an up to date one,
+//        otherwise parse the text file and save a cache for the next run
+void SimpleGR::loadDesign(const string &filename, bool removeBlockedEdges)
+{
+    if (params.useCache && openCache(filename, designCache)) {
+        loadDesignCache(cacheFileName(filename), removeBlockedEdges);
+    } else {
+        designCache.close();
+        parseDesign(filename, removeBlockedEdges);
+        if (params.useCache) { writeDesignCache(cacheFileName(filename), filename); }
+    }
+
+    initBlockedDirs();
+    buildNetOrder();
+}
+
+//@brief: initialize the design from the mapped cache file. Net names are not
+//        copied, the name arenas are views of the mapping.
+void SimpleGR::loadDesignCache(const string &cacheFile, bool removeBlockedEdges)
+{
+    cout << "Reading from `" << cacheFile << "' ..." << endl;
+
+    const char *base = designCache.begin();
+    const DesignCacheHeader &header = *reinterpret_cast<const DesignCacheHeader *>(base);
+
+    gcellArrSzX = header.gcellArrSzX;
+    gcellArrSzY = header.gcellArrSzY;
+    numLayers = header.numLayers;
+    minX = header.minX;
+    minY = header.minY;
+    gcellWidth = header.gcellWidth;
+    gcellHeight = header.gcellHeight;
+    halfWidth = gcellWidth >> 1;
+    halfHeight = gcellHeight >> 1;
+
+    if (numLayers <= 2) params.layerAssign = false;
+
+    cout << "grid size " << gcellArrSzX << "x" << gcellArrSzY << endl;
+
+    const uint32_t *layerValues = reinterpret_cast<const uint32_t *>(base + header.layerOffset);
+    vector<CapType> *layerArrs[] = { &vertCaps, &horizCaps, &minWidths, &minSpacings, &viaSpacings };
+    for (vector<CapType> *arr : layerArrs) {
+        arr->assign(layerValues, layerValues + numLayers);
+        layerValues += numLayers;
+    }
+
+    // The grid holds pointers, so it is always rebuilt. Do that while the nets are loaded.
+    const uint8_t *caps = reinterpret_cast<const uint8_t *>(base + header.capOffset);
+    thread gridThread([this, caps, &header, removeBlockedEdges]() {
+        buildGrid();
+        if (grEdgeArr.size() != header.numEdges) return;
+        for (Edge &edge : grEdgeArr) {
+            edge.capacity = caps[rowMajorEdgeId(edge)];
+            // only edges adjusted to 0 have no capacity, see applyCapacityAdjustments
+            if (edge.capacity == 0 && removeBlockedEdges) {
+                if (edge.type == HORIZ) {
+                    edge.gcell1->incX = NULLID;
+                    edge.gcell2->decX = NULLID;
+                } else if (edge.type == VERT) {
+                    edge.gcell1->incY = NULLID;
+                    edge.gcell2->decY = NULLID;
+                }
+            }
+        }
+    });
+
+    const CachedNet *nets = reinterpret_cast<const CachedNet *>(base + header.netOffset);
+    const uint64_t *nameOffsets = reinterpret_cast<const uint64_t *>(base + header.nameOffsetsOffset);
+    const char *names = base + header.namesOffset;
+
+    grNetArr.resize(header.numNets, Net(routeAlloc()));
+    netDBIdArr.resize(header.numNets);
+    for (IdType i = 0; i < header.numNets; ++i) {
+        Net &net = grNetArr[i];
+        net.id = i;
+        net.gCellOne.setCoord(nets[i].x1, nets[i].y1, nets[i].z1);
+        net.gCellTwo.setCoord(nets[i].x2, nets[i].y2, nets[i].z2);
+        netDBIdArr[i] = nets[i].dbId;
+    }
+    netNameArr.attach(names, nameOffsets, header.numNets);
+    unroutableNetNameArr.attach(names, nameOffsets + header.numNets, header.numNames - header.numNets);
+    routableNets = header.numNets;
+
+    gridThread.join();
+
+    if (grEdgeArr.size() != header.numEdges) {
+        throw InputError("Error: `" + cacheFile + "' does not match the grid, remove it and rerun");
+    }
+
+    cout << "read in " << grNetArr.size() << " GR nets from " << header.numDesignNets << " nets design" << endl;
+}
+
+//@brief: save the parsed design to `cacheFile'. The file is written under a
+//        temporary name first, so a reader never sees a partial cache.
+void SimpleGR::writeDesignCache(const string &cacheFile, const string &designFile) const
+{
+    DesignCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!designStamp(designFile, header)) return;
+    memcpy(header.magic, designCacheMagic, sizeof(designCacheMagic));
+    header.version = designCacheVersion;
+    header.gcellArrSzX = gcellArrSzX;
+    header.gcellArrSzY = gcellArrSzY;
+    header.numLayers = numLayers;
+    header.minX = minX;
+    header.minY = minY;
+    header.gcellWidth = gcellWidth;
+    header.gcellHeight = gcellHeight;
+    header.numDesignNets = static_cast<uint32_t>(grNetArr.size() + unroutableNetNameArr.size());
+    header.numNets = static_cast<uint32_t>(grNetArr.size());
+    header.numNames = header.numDesignNets;
+    header.numEdges = static_cast<uint32_t>(grEdgeArr.size());
+
+    vector<uint32_t> layerValues;
+    for (const vector<CapType> *arr : { &vertCaps, &horizCaps, &minWidths, &minSpacings, &viaSpacings }) {
+        layerValues.insert(layerValues.end(), arr->begin(), arr->end());
+    }
+
+    vector<uint8_t> caps(grEdgeArr.size());
+    for (const Edge &edge : grEdgeArr) caps[rowMajorEdgeId(edge)] = static_cast<uint8_t>(edge.capacity);
+
+    vector<CachedNet> nets(grNetArr.size());
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        const Net &net = grNetArr[i];
+        nets[i] = { net.gCellOne.x, net.gCellOne.y, net.gCellOne.z, net.gCellTwo.x, net.gCellTwo.y, net.gCellTwo.z,
+            netDBIdArr[i] };
+    }
+
+    vector<uint64_t> nameOffsets(1, 0);
+    for (const NameArena *arr : { &netNameArr, &unroutableNetNameArr }) {
+        for (size_t i = 0; i < arr->size(); ++i) { nameOffsets.push_back(nameOffsets.back() + (*arr)[i].size()); }
+    }
+
+    header.layerOffset = align8(sizeof(header));
+    header.capOffset = align8(header.layerOffset + layerValues.size() * sizeof(uint32_t));
+    header.netOffset = align8(header.capOffset + caps.size());
+    header.nameOffsetsOffset = align8(header.netOffset + nets.size() * sizeof(CachedNet));
+    header.namesOffset = align8(header.nameOffsetsOffset + nameOffsets.size() * sizeof(uint64_t));
+    header.fileSize = header.namesOffset + nameOffsets.back();
+
+    const string tmpFile = cacheFile + ".tmp";
+    ofstream out(tmpFile.c_str(), ios::binary);
+    if (!out.good()) {
+        cout << "Warning: could not write design cache `" << cacheFile << "'" << endl;
+        return;
+    }
+
+    uint64_t written = 0;
+    auto writeSection = [&out, &written](uint64_t offset, const void *data, uint64_t bytes) {
+        const char padding[8] = { 0 };
+        out.write(padding, static_cast<streamsize>(offset - written));
+        out.write(static_cast<const char *>(data), static_cast<streamsize>(bytes));
+        written = offset + bytes;
+    };
+    writeSection(0, &header, sizeof(header));
+    writeSection(header.layerOffset, layerValues.data(), layerValues.size() * sizeof(uint32_t));
+    writeSection(header.capOffset, caps.data(), caps.size());
+    writeSection(header.netOffset, nets.data(), nets.size() * sizeof(CachedNet));
+    writeSection(header.nameOffsetsOffset, nameOffsets.data(), nameOffsets.size() * sizeof(uint64_t));
+    for (const NameArena *arr : { &netNameArr, &unroutableNetNameArr }) {
+        for (size_t i = 0; i < arr->size(); ++i) {
+            out.write((*arr)[i].data(), static_cast<streamsize>((*arr)[i].size()));
+        }
+    }
+    out.close();
+
+    if (!out.good() || rename(tmpFile.c_str(), cacheFile.c_str()) != 0) {
+        remove(tmpFile.c_str());
+        cout << "Warning: could not write design cache `" << cacheFile << "'" << endl;
+        return;
+    }
+    cout << "Saved design cache `" << cacheFile << "'" << endl;
+}
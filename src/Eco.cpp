@@ -0,0 +1,262 @@
+/*
+ * Eco.cpp
+ * Incremental rerouting after an engineering change order. The previous
+ * solution is loaded, the nets and capacities listed in a delta file are
+ * changed, and only the nets the changes affect are ripped up. The routing
+ * stages then reroute them and work on the area around the changes only.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "SimpleGR.h"
+
+namespace {
+// gcells around the changed nets and edges that RRR and greedy improvement may
+// also work on
+const CoordType ecoMargin = 2;
+}// namespace
+
+//@brief: load params.ecoSolutionFile and apply the changes of params.ecoDeltaFile.
+//        Nets that are added, moved or removed, nets on edges that a capacity
+//        change leaves overflowing, and nets whose routes in the solution are
+//        broken are left unrouted; all other routes are kept. The delta file has any number of these sections:
+//          remove <n>      followed by n net names
+//          add <n>         followed by n net records as in the design file
+//          move <n>        the same, replacing the pins of existing nets
+//          <n>             n capacity adjustments as in the design file
+void SimpleGR::loadEco(void)
+{
+    parseSolution(params.ecoSolutionFile.c_str());
+    // broken routes of the solution are rerouted along with the ECO
+    vector<IdType> affected = ripUpBrokenRoutes();
+    const size_t brokenNets = affected.size();
+
+    const string &filename = params.ecoDeltaFile;
+    MappedFile file;
+    if (!file.open(filename)) {
+        throw InputError("Error: Could not open `" + filename + "' for reading");
+    } else {
+        cout << "Reading from `" << filename << "' ..." << endl;
+    }
+    Tokenizer tok(file.begin(), file.end(), file.begin(), filename);
+
+    vector<uint8_t> removed(grNetArr.size());
+    vector<uint8_t> removedUnroutable(unroutableNetNameArr.size());
+    vector<IdType> changedEdges;
+    unsigned numRemoved = 0, numAdded = 0, numMoved = 0;
+
+    auto nameOf = [this](uint32_t value) {
+        return (value & unroutableNetFlag) ? unroutableNetNameArr[value & ~unroutableNetFlag] : netNameArr[value];
+    };
+    auto isRemoved = [&](uint32_t value) {
+        return (value & unroutableNetFlag) ? removedUnroutable[value & ~unroutableNetFlag] != 0 : removed[value] != 0;
+    };
+    auto readPin = [&](Point &pin) {
+        const char *pinPos = tok.pos();
+        const double x = tok.readDouble(), y = tok.readDouble();
+        const unsigned layer = tok.readUInt();
+        const double col = floor((x - minX) / gcellWidth), row = floor((y - minY) / gcellHeight);
+        if (col < 0 || col >= gcellArrSzX || row < 0 || row >= gcellArrSzY || layer == 0 || layer > numLayers) {
+            tok.error(pinPos, "Pin outside of the grid");
+        }
+        pin.setCoord(static_cast<CoordType>(col), static_cast<CoordType>(row), layer - 1);
+    };
+
+    while (!tok.atEnd()) {
+        const char *sectionPos = tok.pos();
+        const char section = tok.peek();
+        if (section >= '0' && section <= '9') {
+            // the edges whose capacity changes are found by comparing before and after
+            vector<uint8_t> oldCaps(grEdgeArr.size());
+            for (size_t i = 0; i < grEdgeArr.size(); ++i) oldCaps[i] = grEdgeArr[i].capacity;
+            const bool removeBlockedEdges = true;
+            applyCapacityAdjustments(tok, removeBlockedEdges);
+            for (size_t i = 0; i < grEdgeArr.size(); ++i) {
+                const Edge &edge = grEdgeArr[i];
+                if (edge.capacity == oldCaps[i]) continue;
+                // keep the overflow stats, which useEdge and releaseEdge update, in sync
+                const CapType oldOverflow = edge.usage > oldCaps[i] ? edge.usage - oldCaps[i] : 0;
+                const CapType newOverflow = edge.usage > edge.capacity ? edge.usage - edge.capacity : 0;
+                totalOverflow = totalOverflow - oldOverflow + newOverflow;
+                if (oldOverflow == 0 && newOverflow > 0) ++overfullEdges;
+                if (oldOverflow > 0 && newOverflow == 0) --overfullEdges;
+                updateBlockedDirs(edge);
+                changedEdges.push_back(static_cast<IdType>(i));
+            }
+            continue;
+        }
+
+        const string_view word = tok.nextWord();
+        if (word != "remove" && word != "add" && word != "move") {
+            tok.error(sectionPos, "Expected `remove', `add', `move' or a number of capacity adjustments");
+        }
+        const unsigned count = tok.readUInt();
+        for (unsigned i = 0; i < count; ++i) {
+            const char *namePos = tok.pos();
+            const string_view name = tok.nextWord();
+            uint32_t value = findNetName(name);
+            if (value != NameIndex::NOTFOUND && isRemoved(value)) value = NameIndex::NOTFOUND;
+
+            if (word == "remove") {
+                if (value == NameIndex::NOTFOUND) tok.error(namePos, "Unknown net `" + string(name) + "'");
+                if (value & unroutableNetFlag) {
+                    removedUnroutable[value & ~unroutableNetFlag] = true;
+                } else {
+                    ripUpNet(value);
+                    removed[value] = true;
+                    --routableNets;
+                }
+                ++numRemoved;
+                continue;
+            }
+
+            if (word == "add" && value != NameIndex::NOTFOUND) {
+                tok.error(namePos, "Net `" + string(name) + "' exists already");
+            }
+            if (word == "move" && value == NameIndex::NOTFOUND) {
+                tok.error(namePos, "Unknown net `" + string(name) + "'");
+            }
+            const IdType dbId = tok.readUInt();
+            const char *pinsPos = tok.pos();
+            if (tok.readUInt() != 2) tok.error(pinsPos, "Only 2-pin nets are supported");
+            tok.readUInt();// wire width, unused
+            Point pinOne, pinTwo;
+            readPin(pinOne);
+            readPin(pinTwo);
+            if (word == "add") {
+                ++numAdded;
+            } else {
+                ++numMoved;
+            }
+
+            if (value != NameIndex::NOTFOUND && !(value & unroutableNetFlag)) {
+                // a routable net moves, it keeps its id
+                ripUpNet(value);
+                if (pinOne == pinTwo) {
+                    removed[value] = true;
+                    --routableNets;
+                    value = static_cast<uint32_t>(unroutableNetNameArr.add(name)) | unroutableNetFlag;
+                    removedUnroutable.push_back(false);
+                } else {
+                    grNetArr[value].gCellOne = pinOne;
+                    grNetArr[value].gCellTwo = pinTwo;
+                    netDBIdArr[value] = dbId;
+                    affected.push_back(value);
+                }
+            } else if (value != NameIndex::NOTFOUND && pinOne == pinTwo) {
+                // an unroutable net moves within one gcell
+                continue;
+            } else if (pinOne == pinTwo) {
+                // pins in the same gcell, there is nothing to route
+                value = static_cast<uint32_t>(unroutableNetNameArr.add(name)) | unroutableNetFlag;
+                removedUnroutable.push_back(false);
+            } else {
+                // a new net, or a net that becomes routable
+                if (value != NameIndex::NOTFOUND) removedUnroutable[value & ~unroutableNetFlag] = true;
+                Net newNet(routeAlloc());
+                newNet.gCellOne = pinOne;
+                newNet.gCellTwo = pinTwo;
+                newNet.id = static_cast<IdType>(grNetArr.size());
+                grNetArr.push_back(newNet);
+                netNameArr.add(name);
+                netDBIdArr.push_back(dbId);
+                removed.push_back(false);
+                ++routableNets;
+                value = newNet.id;
+                affected.push_back(value);
+            }
+            // the name now stands for the net's new record
+            netNameIndex.insert(name, value, nameOf);
+        }
+    }
+
+    // nets pushed into overflow by the capacity changes are rerouted as well. A
+    // net crossing several of those edges is ripped up and counted once.
+    size_t ripped = 0;
+    for (IdType edgeId : changedEdges) {
+        if (grEdgeArr[edgeId].usage <= grEdgeArr[edgeId].capacity) continue;
+        const IdList nets = grEdgeArr[edgeId].nets;
+        for (IdType netId : nets) {
+            if (!grNetArr[netId].routed) continue;
+            ripUpNet(netId);
+            affected.push_back(netId);
+            ++ripped;
+        }
+    }
+    // a net may also have been moved more than once, or removed after its broken route was ripped up
+    sort(affected.begin(), affected.end());
+    affected.erase(unique(affected.begin(), affected.end()), affected.end());
+    affected.erase(remove_if(affected.begin(), affected.end(), [&removed](IdType netId) { return removed[netId]; }),
+        affected.end());
+
+    // removed nets keep their ids but are not routed anymore
+    buildNetOrder();
+    netOrder.erase(remove_if(netOrder.begin(), netOrder.end(), [&removed](IdType netId) { return removed[netId]; }),
+        netOrder.end());
+
+    vector<pair<Point, Point>> boxes;
+    for (IdType netId : affected) {
+        const Net &net = grNetArr[netId];
+        boxes.push_back(make_pair(net.gCellOne, net.gCellTwo));
+    }
+    for (IdType edgeId : changedEdges) {
+        const Edge &edge = grEdgeArr[edgeId];
+        boxes.push_back(make_pair(Point(*edge.gcell1), Point(*edge.gcell2)));
+    }
+    buildEcoRegion(boxes);
+
+    cout << "ECO: " << numRemoved << " net(s) removed, " << numAdded << " added, " << numMoved << " moved, "
+         << changedEdges.size() << " edge capacity change(s)" << endl;
+    cout << "ECO: " << ripped << " net(s) ripped up from overflowing edges, " << brokenNets
+         << " with broken routes in the solution" << endl;
+}
+
+//@brief: mark the gcells (x, y) covered by `boxes', grown by ecoMargin, as the
+//        ECO region. The boxes are given by two opposite corners.
+void SimpleGR::buildEcoRegion(const vector<pair<Point, Point>> &boxes)
+{
+    const size_t width = gcellArrSzX + 1, height = gcellArrSzY + 1;
+
+    // count the boxes covering each gcell with a 2D difference array
+    auto lower = [](CoordType a, CoordType b) { return min(a, b) > ecoMargin ? min(a, b) - ecoMargin : 0; };
+    vector<int32_t> cover(width * height, 0);
+    for (const pair<Point, Point> &box : boxes) {
+        const CoordType x0 = lower(box.first.x, box.second.x);
+        const CoordType y0 = lower(box.first.y, box.second.y);
+        const CoordType x1 = min(max(box.first.x, box.second.x) + ecoMargin, gcellArrSzX - 1) + 1;
+        const CoordType y1 = min(max(box.first.y, box.second.y) + ecoMargin, gcellArrSzY - 1) + 1;
+        ++cover[y0 * width + x0];
+        --cover[y0 * width + x1];
+        --cover[y1 * width + x0];
+        ++cover[y1 * width + x1];
+    }
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            if (x > 0) cover[y * width + x] += cover[y * width + x - 1];
+            if (y > 0) cover[y * width + x] += cover[(y - 1) * width + x];
+            if (x > 0 && y > 0) cover[y * width + x] -= cover[(y - 1) * width + x - 1];
+        }
+    }
+
+    // ecoRegionSum[(y + 1) * width + x + 1] counts the region's gcells in [0, x] x [0, y]
+    ecoRegionSum.assign(width * height, 0);
+    for (size_t y = 1; y < height; ++y) {
+        for (size_t x = 1; x < width; ++x) {
+            ecoRegionSum[y * width + x] = (cover[(y - 1) * width + x - 1] > 0) + ecoRegionSum[y * width + x - 1]
+                                          + ecoRegionSum[(y - 1) * width + x] - ecoRegionSum[(y - 1) * width + x - 1];
+        }
+    }
+}
+
+//@brief: check whether the box [x0, x1] x [y0, y1] touches the ECO region
+//@ret:   true if it does, or if there is no ECO
+bool SimpleGR::inEcoRegion(CoordType x0, CoordType y0, CoordType x1, CoordType y1) const
+{
+    if (ecoRegionSum.empty()) return true;
+    const size_t width = gcellArrSzX + 1;
+    const uint32_t count = ecoRegionSum[(y1 + 1) * width + x1 + 1] - ecoRegionSum[y0 * width + x1 + 1]
+                           - ecoRegionSum[(y1 + 1) * width + x0] + ecoRegionSum[y0 * width + x0];
+    return count > 0;
+}
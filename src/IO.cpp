@@ -1,50 +1,212 @@
 #include <algorithm>
 #include <cassert>
-#include <climits>
+#include <charconv>
+#include <condition_variable>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 using namespace std;
 
 #include "SimpleGR.h"
+#include "Tokenizer.h"
 
-void expect(string s1, string s2)
+namespace {
+// Net records as they appear in the design file. Pins are kept in detailed
+// coordinates until a whole chunk of the net section is read, so that the
+// translation to gcells can be done in one pass over flat arrays.
+struct NetRecords
 {
-    if (s1 != s2) {
-        cout << "Parsing error. Expected `" << s2 << "' but got `" << s1 << "' instead" << endl;
-        exit(0);
+    vector<string_view> names;
+    vector<IdType> dbIds;
+    vector<double> pinX, pinY;// two pins per net
+    vector<CoordType> pinZ;
+    vector<CoordType> gcellX, gcellY;// filled in by translatePins()
+
+    size_t size(void) const { return names.size(); }
+
+    // reads net records until the end of the tokenizer's range or `maxNets' nets
+    void parse(Tokenizer &tok, size_t maxNets)
+    {
+        while (size() < maxNets && !tok.atEnd()) {
+            names.push_back(tok.nextWord());
+            dbIds.push_back(tok.readUInt());
+            const char *pinsPos = tok.pos();
+            const unsigned numPins = tok.readUInt();
+            tok.readUInt();// wire width, unused
+
+            // In this project, all nets have exactly 2 pins.
+            if (numPins != 2) { tok.error(pinsPos, "Only 2-pin nets are supported"); }
+
+            for (unsigned p = 0; p < 2; ++p) {
+                pinX.push_back(tok.readDouble());
+                pinY.push_back(tok.readDouble());
+                pinZ.push_back(tok.readUInt() - 1);
+            }
+        }
     }
+
+    // translate detailed pin coords to global grid coords, all pins at once
+    void translatePins(LenType minX, LenType minY, LenType gcellWidth, LenType gcellHeight)
+    {
+        const size_t numPins = pinX.size();
+        gcellX.resize(numPins);
+        gcellY.resize(numPins);
+        for (size_t i = 0; i < numPins; ++i) {
+            gcellX[i] = static_cast<CoordType>(floor((pinX[i] - minX) / gcellWidth));
+        }
+        for (size_t i = 0; i < numPins; ++i) {
+            gcellY[i] = static_cast<CoordType>(floor((pinY[i] - minY) / gcellHeight));
+        }
+    }
+};
+
+// reads one value per layer
+void readLayerValues(Tokenizer &tok, unsigned numLayers, vector<CapType> &values)
+{
+    values.clear();
+    for (unsigned i = 0; i < numLayers; ++i) { values.push_back(tok.readUInt()); }
 }
 
-//@brief: load a design benchmark into memory. This function parses the input file
-// and initializes the global routing data structures for the grid, layer capacities,
-// edge widths and spacing, and number of nets
-void SimpleGR::parseInput()
+// number of whitespace separated words on the line starting at `line'
+unsigned countLineWords(const char *line, const char *end)
 {
-    if (params.inputFile.empty()) {
-        cout << "Error: Unspecified design file" << endl;
-        exit(0);
+    unsigned words = 0;
+    bool inWord = false;
+    for (const char *p = line; p != end && *p != '\n'; ++p) {
+        const bool space = (*p == ' ' || *p == '\t' || *p == '\r');
+        if (!space && !inWord) ++words;
+        inWord = !space;
+    }
+    return words;
+}
+
+// Returns the beginning of the first net record at or after `pos'. A record
+// starts with the only line of 4 words ("name id numPins wireWidth"), pin lines
+// have 3. Returns `end' if no record starts in [pos, end).
+const char *nextNetRecord(const char *pos, const char *begin, const char *end)
+{
+    // back up to the beginning of the line `pos' is on
+    while (pos != begin && pos[-1] != '\n') --pos;
+    while (pos != end) {
+        if (countLineWords(pos, end) == 4) return pos;
+        pos = static_cast<const char *>(memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        pos = (pos == NULL) ? end : pos + 1;
+    }
+    return end;
+}
+
+// Locates the capacity adjustment section by walking back from the end of the
+// file: it is a line with the number of adjustments followed by that many lines
+// of 7 words. Returns NULL if the tail of the file does not look like that, in
+// which case the caller has to find the section by parsing all nets first.
+const char *findCapacitySection(const char *begin, const char *end)
+{
+    unsigned adjustments = 0;
+    const char *lineEnd = end;
+    while (lineEnd != begin) {
+        const char *line = lineEnd;
+        while (line != begin && line[-1] != '\n') --line;
+        const unsigned words = countLineWords(line, lineEnd);
+        if (words == 1) {
+            // the count has to match the lines seen so far
+            unsigned count = 0;
+            std::from_chars_result res = std::from_chars(line + strspn(line, " \t"), lineEnd, count);
+            return (res.ec == std::errc() && count == adjustments) ? line : NULL;
+        } else if (words == 7) {
+            ++adjustments;
+        } else if (words != 0) {
+            return NULL;
+        }
+        lineEnd = (line == begin) ? begin : line - 1;
+    }
+    return NULL;
+}
+
+// Returns the beginning of the first route record after the line `pos' is on.
+// A record ends with a line holding only `!'. Returns `end' if there is none.
+const char *nextRouteRecord(const char *pos, const char *begin, const char *end)
+{
+    while (pos != begin && pos[-1] != '\n') --pos;
+    while (pos != end) {
+        const char *lineEnd = static_cast<const char *>(memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        if (lineEnd == NULL) lineEnd = end;
+        const char *word = pos;
+        while (word != lineEnd && (*word == ' ' || *word == '\t')) ++word;
+        const bool recordEnd = (word != lineEnd && *word == '!');
+        pos = (lineEnd == end) ? end : lineEnd + 1;
+        if (recordEnd) return pos;
+    }
+    return end;
+}
+
+// Parses a route segment line "(x1,y1,z1)-(x2,y2,z2)". Blanks between the
+// tokens are allowed. Returns false if `line' is not a segment.
+bool parseSegment(string_view line, unsigned coords[6])
+{
+    static const char *const separators[7] = { "(", ",", ",", ")-(", ",", ",", ")" };
+    const char *p = line.data();
+    const char *end = p + line.size();
+    auto skipBlanks = [&p, end]() {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    };
+    for (unsigned i = 0; i < 7; ++i) {
+        for (const char *sep = separators[i]; *sep != '\0'; ++sep) {
+            skipBlanks();
+            if (p == end || *p != *sep) return false;
+            ++p;
+        }
+        if (i == 6) break;
+        skipBlanks();
+        std::from_chars_result res = std::from_chars(p, end, coords[i]);
+        if (res.ec != std::errc()) return false;
+        p = res.ptr;
     }
-    ifstream infile(params.inputFile.c_str());
+    skipBlanks();
+    return p == end;
+}
+
+// Routes of a consecutive range of records of a solution file
+struct RouteRecords
+{
+    vector<uint32_t> nets;// result of findNetName for every record
+    vector<size_t> firstEdge;// nets.size() + 1 entries into edges
+    vector<IdType> edges;// sorted and unique per record
 
-    if (!infile.good()) {
-        cout << "Error: Could not open `" << params.inputFile << "' for reading" << endl;
-        exit(0);
+    RouteRecords() : firstEdge(1, 0) {}
+};
+}// namespace
+
+//@brief: load a design benchmark into memory. The file is memory mapped and
+// tokenized in place. This function initializes the global routing data structures
+// for the grid, layer capacities, edge widths and spacing, and number of nets.
+// The net section is parsed by params.numThreads threads while the grid is being
+// built and the capacity adjustments are applied on another one.
+//@param: removeBlockedEdges disconnects edges whose capacity is adjusted to 0 from
+//        the grid, so that the router never considers them
+void SimpleGR::parseDesign(const string &filename, bool removeBlockedEdges)
+{
+    MappedFile file;
+    if (!file.open(filename)) {
+        throw InputError("Error: Could not open `" + filename + "' for reading");
     } else {
-        cout << "Reading from `" << params.inputFile << "' ..." << endl;
+        cout << "Reading from `" << filename << "' ..." << endl;
     }
 
-    string textstring;
+    Tokenizer tok(file.begin(), file.end(), file.begin(), filename);
 
     // Read in the grid dimensions and the number of layers from the input file
-    infile >> textstring;
-    expect(textstring, string("grid"));
-    infile >> gcellArrSzX >> gcellArrSzY >> numLayers;
+    tok.expect("grid");
+    gcellArrSzX = tok.readUInt();
+    gcellArrSzY = tok.readUInt();
+    numLayers = tok.readUInt();
 
     // always true for this assignment
     if (numLayers <= 2) params.layerAssign = false;
@@ -52,181 +214,206 @@ void SimpleGR::parseInput()
     cout << "grid size " << gcellArrSzX << "x" << gcellArrSzY << endl;
 
     // Read in the vertical and horizontal capacities for each layer
-    infile >> textstring;
-    expect(textstring, string("vertical"));
-    infile >> textstring;
-    expect(textstring, string("capacity"));
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned cap;
-        infile >> cap;
-        vertCaps.push_back(cap);
-    }
+    tok.expect("vertical");
+    tok.expect("capacity");
+    readLayerValues(tok, numLayers, vertCaps);
 
-    infile >> textstring;
-    expect(textstring, string("horizontal"));
-    infile >> textstring;
-    expect(textstring, string("capacity"));
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned cap;
-        infile >> cap;
-        horizCaps.push_back(cap);
-    }
-    // checkpoint
-
-    // Read in the minimum width and spacing for edges on each layer
-    infile >> textstring;
-    expect(textstring, string("minimum"));
-    infile >> textstring;
-    expect(textstring, string("width"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned minwidth;
-        infile >> minwidth;
-        minWidths.push_back(minwidth);
-    }
+    tok.expect("horizontal");
+    tok.expect("capacity");
+    readLayerValues(tok, numLayers, horizCaps);
 
-    infile >> textstring;
-    expect(textstring, string("minimum"));
-    infile >> textstring;
-    expect(textstring, string("spacing"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned minspacing;
-        infile >> minspacing;
-        minSpacings.push_back(minspacing);
-    }
-    // checkpoint
-
-    // Use minWidths and minSpacings to calculate the routing demand for each segment on each layer.
+    // Read in the minimum width and spacing for edges on each layer.
     // Routing demand = minimum width + minimum spacing for each segment on each layer.
+    tok.expect("minimum");
+    tok.expect("width");
+    readLayerValues(tok, numLayers, minWidths);
+
+    tok.expect("minimum");
+    tok.expect("spacing");
+    readLayerValues(tok, numLayers, minSpacings);
 
     // Read in via spacing, but it won't be used
-    infile >> textstring;
-    expect(textstring, string("via"));
-    infile >> textstring;
-    expect(textstring, string("spacing"));
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned viaspacing;
-        infile >> viaspacing;
-        viaSpacings.push_back(viaspacing);
-    }
+    tok.expect("via");
+    tok.expect("spacing");
+    readLayerValues(tok, numLayers, viaSpacings);
 
-    infile >> minX >> minY >> gcellWidth >> gcellHeight;
+    minX = tok.readUInt();
+    minY = tok.readUInt();
+    gcellWidth = tok.readUInt();
+    gcellHeight = tok.readUInt();
 
     halfWidth = gcellWidth >> 1;
     halfHeight = gcellHeight >> 1;
 
     // Read in the number of nets and their data
-    unsigned numNets;
-    infile >> textstring;
-    expect(textstring, string("num"));
-    infile >> textstring;
-    expect(textstring, string("net"));
-    infile >> numNets;
-    grNetArr.reserve(numNets);
+    tok.expect("num");
+    tok.expect("net");
+    const unsigned numNets = tok.readUInt();
+
+    const char *netsBegin = tok.pos();
+    const char *netsEnd = findCapacitySection(netsBegin, file.end());
+
+    vector<NetRecords> chunks;
+    if (netsEnd == NULL) {
+        // Unusual layout, read everything in order on this thread
+        chunks.resize(1);
+        chunks[0].parse(tok, numNets);
+        chunks[0].translatePins(minX, minY, gcellWidth, gcellHeight);
+        buildGrid();
+        applyCapacityAdjustments(tok, removeBlockedEdges);
+    } else {
+        // The grid only depends on the header, build it and apply the capacity
+        // adjustments while the nets are being parsed. The capacity section is
+        // the last part of the file.
+        PartErrors errors;
+        thread gridThread([this, netsEnd, &file, &filename, removeBlockedEdges, &errors]() {
+            errors.run(numeric_limits<size_t>::max(), [&]() {
+                buildGrid();
+                Tokenizer capTok(netsEnd, file.end(), file.begin(), filename);
+                applyCapacityAdjustments(capTok, removeBlockedEdges);
+            });
+        });
+
+        // Split the net section at record boundaries. Small sections are not
+        // worth a thread each.
+        const size_t minChunkBytes = 1 << 20;
+        const size_t sectionBytes = static_cast<size_t>(netsEnd - netsBegin);
+        const size_t numChunks = max<size_t>(1, min<size_t>(params.numThreads, sectionBytes / minChunkBytes));
+        vector<const char *> bounds(1, netsBegin);
+        for (size_t i = 1; i < numChunks; ++i) {
+            const char *bound = nextNetRecord(netsBegin + i * sectionBytes / numChunks, netsBegin, netsEnd);
+            if (bound > bounds.back()) bounds.push_back(bound);
+        }
+        bounds.push_back(netsEnd);
+
+        chunks.resize(bounds.size() - 1);
+        auto parseChunk = [&](size_t i) {
+            errors.run(i, [&]() {
+                Tokenizer chunkTok(bounds[i], bounds[i + 1], file.begin(), filename);
+                chunks[i].parse(chunkTok, numNets);
+                if (!chunkTok.atEnd()) { chunkTok.error(chunkTok.pos(), "More nets than specified by `num net'"); }
+                chunks[i].translatePins(minX, minY, gcellWidth, gcellHeight);
+            });
+        };
+        vector<thread> workers;
+        for (size_t i = 1; i < chunks.size(); ++i) { workers.emplace_back(parseChunk, i); }
+        parseChunk(0);
+        for (thread &worker : workers) { worker.join(); }
+
+        gridThread.join();
+        errors.rethrow();
+    }
 
-    // Loop to read in each net's data such as ID, number of pins, wire width and pin locations within the grid
-    for (unsigned i = 0; i < numNets; ++i) {
-        Net newNet;
-        unsigned numPins;
-        unsigned wireWidth;
-        string name;
-        IdType dbId;
-
-        infile >> name >> dbId >> numPins >> wireWidth;
-
-        // In this project, all nets have exactly 2 pins.
-        assert(numPins == 2);
-
-        double pinX, pinY;
-        unsigned layer;
-
-        infile >> pinX >> pinY >> layer;
-        // translate detailed pin coords to global grid coords
-        newNet.gCellOne.x = static_cast<unsigned>(floor((pinX - minX) / gcellWidth));
-        newNet.gCellOne.y = static_cast<unsigned>(floor((pinY - minY) / gcellHeight));
-        newNet.gCellOne.z = layer - 1;
-
-        infile >> pinX >> pinY >> layer;
-        // translate detailed pin coords to global grid coords
-        newNet.gCellTwo.x = static_cast<unsigned>(floor((pinX - minX) / gcellWidth));
-        newNet.gCellTwo.y = static_cast<unsigned>(floor((pinY - minY) / gcellHeight));
-        newNet.gCellTwo.z = layer - 1;
-
-        // If the pins of a net are in the same global cell ignore the net as it is unroutable.
-        if (newNet.gCellOne != newNet.gCellTwo) {
-            ++routableNets;
-
-            newNet.id = static_cast<IdType>(grNetArr.size());
-            grNetArr.push_back(newNet);
-            netNameToPtrMap[name] = &grNetArr.back();
-            netNameArr.push_back(name);
-            netDBIdArr.push_back(dbId);
-        } else {
-            netNameToPtrMap[name] = NULL;
+    // Merge the chunks in file order, so net ids do not depend on the number of threads
+    size_t numParsed = 0;
+    for (const NetRecords &chunk : chunks) { numParsed += chunk.size(); }
+    if (numParsed != numNets) {
+        throw InputError("Parsing error in `" + filename + "'. Expected " + to_string(numNets) + " nets but found "
+                         + to_string(numParsed));
+    }
+
+    // Names go to the arenas, so storing them takes two allocations in total
+    size_t nameBytes = 0;
+    for (const NetRecords &chunk : chunks) {
+        for (string_view name : chunk.names) { nameBytes += name.size(); }
+    }
+    netNameArr.reserve(numNets, nameBytes);
+    vector<string_view> unroutableNames;
+
+    grNetArr.reserve(numNets);
+    for (const NetRecords &chunk : chunks) {
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            Net newNet(routeAlloc());
+            newNet.gCellOne.setCoord(chunk.gcellX[2 * i], chunk.gcellY[2 * i], chunk.pinZ[2 * i]);
+            newNet.gCellTwo.setCoord(chunk.gcellX[2 * i + 1], chunk.gcellY[2 * i + 1], chunk.pinZ[2 * i + 1]);
+
+            // If the pins of a net are in the same global cell ignore the net as it is unroutable.
+            if (newNet.gCellOne != newNet.gCellTwo) {
+                ++routableNets;
+
+                newNet.id = static_cast<IdType>(grNetArr.size());
+                grNetArr.push_back(newNet);
+                netNameArr.add(chunk.names[i]);
+                netDBIdArr.push_back(chunk.dbIds[i]);
+            } else {
+                unroutableNames.push_back(chunk.names[i]);
+            }
         }
     }
-    // checkpoint
 
-    cout << "read in " << grNetArr.size() << " GR nets from " << numNets << " nets design" << endl;
+    size_t unroutableBytes = 0;
+    for (string_view name : unroutableNames) { unroutableBytes += name.size(); }
+    unroutableNetNameArr.reserve(unroutableNames.size(), unroutableBytes);
+    for (string_view name : unroutableNames) { unroutableNetNameArr.add(name); }
 
-    // build the routing grid graph
-    buildGrid();
+    cout << "read in " << grNetArr.size() << " GR nets from " << numNets << " nets design" << endl;
+}
 
-    unsigned capacityChanges;
-    infile >> capacityChanges;
+//@brief: read the capacity adjustment section and apply it to the grid. The grid
+//        has to be built already.
+void SimpleGR::applyCapacityAdjustments(Tokenizer &tok, bool removeBlockedEdges)
+{
+    const unsigned capacityChanges = tok.readUInt();
 
     // Start to apply the capacity adjustments
     for (unsigned i = 0; i < capacityChanges; ++i) {
-        unsigned gridCol1, gridRow1, layer1, gridCol2, gridRow2, layer2, newCap;
-
-        infile >> gridCol1 >> gridRow1 >> layer1 >> gridCol2 >> gridRow2 >> layer2 >> newCap;
+        const char *adjustPos = tok.pos();
+        const unsigned gridCol1 = tok.readUInt(), gridRow1 = tok.readUInt(), layer1 = tok.readUInt();
+        const unsigned gridCol2 = tok.readUInt(), gridRow2 = tok.readUInt(), layer2 = tok.readUInt();
+        const unsigned newCap = tok.readUInt();
 
-        assert(layer1 == layer2);
-        assert(layer1 <= 2);
-        assert(layer2 <= 2);
+        if (layer1 != layer2 || layer1 == 0 || layer1 > numLayers) {
+            tok.error(adjustPos, "Bad capacity adjustment.");
+        }
+        if (max(gridCol1, gridCol2) >= gcellArrSzX || max(gridRow1, gridRow2) >= gcellArrSzY) {
+            tok.error(adjustPos, "Capacity adjustment outside of the grid.");
+        }
 
         if (gridCol1 == gridCol2) {
             // This is a vertical edge within the grid
             assert(gridRow1 == gridRow2 + 1 || gridRow1 + 1 == gridRow2);
-            if (gcellArr3D[layer1 - 1][min(gridRow1, gridRow2)][gridCol1].incY == NULLID) {
-                if (newCap != 0.) {
-                    cout << "Error: Adjusting capacity on a previously non-existing edge." << endl;
-                    exit(0);
-                }
+            GCell &lower = gcellAt(gridCol1, min(gridRow1, gridRow2), layer1 - 1);
+            if (lower.incY == NULLID) {
+                if (newCap != 0) { tok.error(adjustPos, "Adjusting capacity on a previously non-existing edge."); }
             } else {
-                grEdgeArr[gcellArr3D[layer1 - 1][min(gridRow1, gridRow2)][gridCol1].incY].capacity = newCap;
+                grEdgeArr[lower.incY].capacity = newCap;
                 // If the veritical edge capacity is set to 0, it removes the edge from the grid as it is already
                 // occupied
-                if (newCap == 0.) {
-                    gcellArr3D[layer1 - 1][min(gridRow1, gridRow2)][gridCol1].incY = NULLID;
-                    gcellArr3D[layer1 - 1][max(gridRow1, gridRow2)][gridCol1].decY = NULLID;
+                if (newCap == 0 && removeBlockedEdges) {
+                    lower.incY = NULLID;
+                    gcellAt(gridCol1, max(gridRow1, gridRow2), layer1 - 1).decY = NULLID;
                 }
             }
         } else if (gridRow1 == gridRow2) {
             // This is a horizontal edge with the grid
             assert(gridCol1 == gridCol2 + 1 || gridCol1 + 1 == gridCol2);
-            if (gcellArr3D[layer1 - 1][gridRow1][min(gridCol1, gridCol2)].incX == NULLID) {
-                if (newCap != 0.) {
-                    cout << "Error: Adjusting capacity on a previously non-existing edge." << endl;
-                    exit(0);
-                }
+            GCell &left = gcellAt(min(gridCol1, gridCol2), gridRow1, layer1 - 1);
+            if (left.incX == NULLID) {
+                if (newCap != 0) { tok.error(adjustPos, "Adjusting capacity on a previously non-existing edge."); }
             } else {
-                grEdgeArr[gcellArr3D[layer1 - 1][gridRow1][min(gridCol1, gridCol2)].incX].capacity = newCap;
+                grEdgeArr[left.incX].capacity = newCap;
                 // If the horizontal edge capacity is set to 0, it removes the edge from the grid as it is already
                 // occupied
-                if (newCap == 0.) {
-                    gcellArr3D[layer1 - 1][gridRow1][min(gridCol1, gridCol2)].incX = NULLID;
-                    gcellArr3D[layer1 - 1][gridRow1][max(gridCol1, gridCol2)].decX = NULLID;
+                if (newCap == 0 && removeBlockedEdges) {
+                    left.incX = NULLID;
+                    gcellAt(max(gridCol1, gridCol2), gridRow1, layer1 - 1).decX = NULLID;
                 }
             }
         } else {
-            cout << "Error: Bad capacity adjustment." << endl;
-            exit(0);
+            tok.error(adjustPos, "Bad capacity adjustment.");
         }
     }
+}
+
+//@brief: load the design given by -f for routing
+void SimpleGR::parseInput()
+{
+    if (params.inputFile.empty()) {
+        throw InputError("Error: Unspecified design file");
+    }
 
-    infile.close();
+    const bool removeBlockedEdges = true;
+    loadDesign(params.inputFile, removeBlockedEdges);
 
     // Initialize the priority queue for maze routing
     priorityQueue.resize(numLayers * gcellArrSzX * gcellArrSzY);
@@ -234,274 +421,207 @@ void SimpleGR::parseInput()
     cout << "CPU time: " << cpuTime() << " seconds" << endl;
 }
 
+//@brief: load a design for evaluating a solution. Blocked edges are kept in the
+//        grid so that solutions using them can still be read and reported.
 void SimpleGR::parseInputMapper(const char *filename)
 {
-    ifstream infile(filename);
-
-    if (!infile.good()) {
-        cout << "Could not open `" << filename << "' for reading" << endl;
-        exit(0);
-    } else {
-        cout << "Reading from `" << filename << "' ..." << endl;
-    }
-
-    string tmp;
-
-    infile >> tmp;
-    expect(tmp, string("grid"));
-
-    infile >> gcellArrSzX >> gcellArrSzY >> numLayers;
-
-    if (numLayers <= 2) params.layerAssign = false;
-
-    cout << "grid size " << gcellArrSzX << "x" << gcellArrSzY << endl;
-
-    infile >> tmp;
-    expect(tmp, string("vertical"));
-    infile >> tmp;
-    expect(tmp, string("capacity"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned cap;
-        infile >> cap;
-        vertCaps.push_back(cap);
-    }
-
-    infile >> tmp;
-    expect(tmp, string("horizontal"));
-    infile >> tmp;
-    expect(tmp, string("capacity"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned cap;
-        infile >> cap;
-        horizCaps.push_back(cap);
-    }
-
-    infile >> tmp;
-    expect(tmp, string("minimum"));
-    infile >> tmp;
-    expect(tmp, string("width"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned minwidth;
-        infile >> minwidth;
-        minWidths.push_back(minwidth);
-    }
-
-    infile >> tmp;
-    expect(tmp, string("minimum"));
-    infile >> tmp;
-    expect(tmp, string("spacing"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned minspacing;
-        infile >> minspacing;
-        minSpacings.push_back(minspacing);
-    }
-
-    infile >> tmp;
-    expect(tmp, string("via"));
-    infile >> tmp;
-    expect(tmp, string("spacing"));
-
-    for (unsigned i = 0; i < numLayers; ++i) {
-        unsigned viaspacing;
-        infile >> viaspacing;
-        viaSpacings.push_back(viaspacing);
-    }
-
-    infile >> minX >> minY >> gcellWidth >> gcellHeight;
-
-    halfWidth = static_cast<LenType>(trunc(0.5 * gcellWidth));
-    halfHeight = static_cast<LenType>(trunc(0.5 * gcellHeight));
-
-    infile >> tmp;
-    expect(tmp, string("num"));
-    infile >> tmp;
-    expect(tmp, string("net"));
-
-    unsigned numNets;
-
-    infile >> numNets;
-
-    cout << "total nets " << numNets << endl;
-
-    grNetArr.reserve(numNets);
-
-    for (unsigned i = 0; i < numNets; ++i) {
-        Net temp;
-        unsigned wireWidth;
-        unsigned numPins;
-        string name;
-        IdType id;
-
-        infile >> name >> id >> numPins >> wireWidth;
-
-        // For this project, all nets have exactly 2 pins.
-        assert(numPins == 2);
-
-        // translate absolute coords to grid coords
-        double pinX, pinY;
-        unsigned layer;
-
-        infile >> pinX >> pinY >> layer;
-        temp.gCellOne.x = static_cast<unsigned>(floor((pinX - minX) / gcellWidth));
-        temp.gCellOne.y = static_cast<unsigned>(floor((pinY - minY) / gcellHeight));
-        temp.gCellOne.z = layer - 1;
-
-        infile >> pinX >> pinY >> layer;
-        temp.gCellTwo.x = static_cast<unsigned>(floor((pinX - minX) / gcellWidth));
-        temp.gCellTwo.y = static_cast<unsigned>(floor((pinY - minY) / gcellHeight));
-        temp.gCellTwo.z = layer - 1;
-
-        if (temp.gCellOne != temp.gCellTwo) {
-            ++routableNets;
-
-            grNetArr.push_back(temp);
-            netNameToPtrMap[name] = &grNetArr.back();
-            netNameArr.push_back(name);
-            netDBIdArr.push_back(id);
-        } else {
-            netNameToPtrMap[name] = NULL;
-        }
-    }
-
-    // build the routing grid graph
-    buildGrid();
-
-    unsigned capacityChanges;
-    infile >> capacityChanges;
-
-    for (unsigned i = 0; i < capacityChanges; ++i) {
-        unsigned gridCol1, gridRow1, layer1, gridCol2, gridRow2, layer2, newCap;
-
-        infile >> gridCol1 >> gridRow1 >> layer1 >> gridCol2 >> gridRow2 >> layer2 >> newCap;
+    const bool removeBlockedEdges = false;
+    loadDesign(filename, removeBlockedEdges);
+}
 
-        assert(layer1 == layer2);
-        if (gridCol1 == gridCol2) {
-            // vert segment
-            assert(gridRow1 == gridRow2 + 1 || gridRow1 + 1 == gridRow2);
-            grEdgeArr[gcellArr3D[layer1 - 1][min(gridRow1, gridRow2)][gridCol1].incY].capacity = newCap;
-        } else if (gridRow1 == gridRow2) {
-            // horiz segment
-            assert(gridCol1 == gridCol2 + 1 || gridCol1 + 1 == gridCol2);
-            grEdgeArr[gcellArr3D[layer1 - 1][gridRow1][min(gridCol1, gridCol2)].incX].capacity = newCap;
-        } else {
-            assert(0);
-        }
+//@brief: index the names of all nets of the design, see netNameIndex
+void SimpleGR::buildNetNameIndex(void)
+{
+    auto nameOf = [this](uint32_t value) {
+        return (value & unroutableNetFlag) ? unroutableNetNameArr[value & ~unroutableNetFlag] : netNameArr[value];
+    };
+    netNameIndex.clear();
+    netNameIndex.reserve(netNameArr.size() + unroutableNetNameArr.size());
+    for (uint32_t i = 0; i < netNameArr.size(); ++i) { netNameIndex.insert(netNameArr[i], i, nameOf); }
+    for (uint32_t i = 0; i < unroutableNetNameArr.size(); ++i) {
+        netNameIndex.insert(unroutableNetNameArr[i], unroutableNetFlag | i, nameOf);
     }
+}
 
-    infile.close();
+//@brief: look up a net by name
+//@ret:   the net id, unroutableNetFlag | index for unroutable nets, or NameIndex::NOTFOUND
+uint32_t SimpleGR::findNetName(string_view name) const
+{
+    return netNameIndex.find(name, [this](uint32_t value) {
+        return (value & unroutableNetFlag) ? unroutableNetNameArr[value & ~unroutableNetFlag] : netNameArr[value];
+    });
 }
 
+//@brief: read the routes of a solution file and commit them to the grid. The
+//        file is memory mapped and split at record boundaries; the chunks are
+//        tokenized and converted to edges in parallel, and then committed in file
+//        order. A segment has to follow grid edges along one axis, segments that
+//        overlap within a net are committed once.
 void SimpleGR::parseSolution(const char *filename)
 {
-    ifstream infile(filename);
+    if (netNameIndex.empty()) { buildNetNameIndex(); }
 
-    if (!infile.good()) {
-        cout << "Could not open `" << filename << "' for reading" << endl;
-        exit(0);
+    const string fname(filename);
+    MappedFile file;
+    if (!file.open(fname)) {
+        throw InputError("Could not open `" + fname + "' for reading");
     } else {
         cout << "Reading from `" << filename << "' ..." << endl;
     }
 
-    string netname;
-
-    infile >> netname;
+    // convert a segment to the edges it covers, appending them to `edges'
+    auto segmentEdges = [this](Tokenizer &tok, const char *where, const unsigned c[6], vector<IdType> &edges) {
+        const unsigned x1 = (c[0] - minX) / gcellWidth, x2 = (c[3] - minX) / gcellWidth;
+        const unsigned y1 = (c[1] - minY) / gcellHeight, y2 = (c[4] - minY) / gcellHeight;
+        const unsigned z1 = c[2] - 1, z2 = c[5] - 1;
 
-    while (infile.good()) {
-        if (netNameToPtrMap.find(netname) == netNameToPtrMap.end()) {
-            cout << "unknown net with name `" << netname << "'" << endl;
-            exit(0);
+        if (x1 >= gcellArrSzX || x2 >= gcellArrSzX) {
+            tok.error(where, "Illegal x position " + to_string(x1 >= gcellArrSzX ? c[0] : c[3]));
         }
-
-        Net &net = *netNameToPtrMap[netname];
-
-        char junk;
-        string restofline;
-        getline(infile, restofline);
-
-        while (infile.peek() == '(') {
-            unsigned x1, y1, z1, x2, y2, z2;
-            infile >> junk >> x1 >> junk >> y1 >> junk >> z1 >> junk >> junk >> junk >> x2 >> junk >> y2 >> junk >> z2;
-            getline(infile, restofline);
-
-            unsigned gcell1x, gcell1y, gcell1z, gcell2x, gcell2y, gcell2z;
-
-            gcell1x = static_cast<unsigned>(floor((x1 - minX) / gcellWidth));
-            gcell2x = static_cast<unsigned>(floor((x2 - minX) / gcellWidth));
-            gcell1y = static_cast<unsigned>(floor((y1 - minY) / gcellHeight));
-            gcell2y = static_cast<unsigned>(floor((y2 - minY) / gcellHeight));
-            gcell1z = z1 - 1;
-            gcell2z = z2 - 1;
-
-            if (gcell1x >= gcellArrSzX) {
-                cout << "illegal x position " << x1 << endl;
-                exit(0);
-            }
-            if (gcell1y >= gcellArrSzY) {
-                cout << "illegal y position " << y1 << endl;
-                exit(0);
-            }
-            if (gcell1z >= numLayers) {
-                cout << "illegal layer " << z1 << endl;
-                exit(0);
-            }
-
-            if (gcell2x >= gcellArrSzX) {
-                cout << "illegal x position " << x2 << endl;
-                exit(0);
-            }
-            if (gcell2y >= gcellArrSzY) {
-                cout << "illegal y position " << y2 << endl;
-                exit(0);
-            }
-            if (gcell2z >= numLayers) {
-                cout << "illegal layer " << z2 << endl;
-                exit(0);
+        if (y1 >= gcellArrSzY || y2 >= gcellArrSzY) {
+            tok.error(where, "Illegal y position " + to_string(y1 >= gcellArrSzY ? c[1] : c[4]));
+        }
+        if (z1 >= numLayers || z2 >= numLayers) {
+            tok.error(where, "Illegal layer " + to_string(z1 >= numLayers ? c[2] : c[5]));
+        }
+        if ((x1 != x2) + (y1 != y2) + (z1 != z2) > 1) tok.error(where, "Segment is not parallel to an axis");
+
+        const size_t first = edges.size();
+        for (unsigned j = min(x1, x2); j < max(x1, x2); ++j) edges.push_back(gcellAt(j, y1, z1).incX);
+        for (unsigned j = min(y1, y2); j < max(y1, y2); ++j) edges.push_back(gcellAt(x1, j, z1).incY);
+        for (unsigned j = min(z1, z2); j < max(z1, z2); ++j) edges.push_back(gcellAt(x1, y1, j).incZ);
+        if (find(edges.begin() + static_cast<ptrdiff_t>(first), edges.end(), NULLID) != edges.end()) {
+            tok.error(where, "Segment does not follow the routing direction of its layer");
+        }
+    };
+
+    auto parseRecords = [&](Tokenizer &tok, RouteRecords &records) {
+        unsigned coords[6];
+        while (!tok.atEnd()) {
+            const string_view name = tok.nextWord();
+            const uint32_t netId = findNetName(name);
+            if (netId == NameIndex::NOTFOUND) { tok.error(name.data(), "Unknown net `" + string(name) + "'"); }
+            tok.readLine();
+
+            const size_t first = records.edges.size();
+            while (tok.peek() == '(') {
+                const char *where = tok.pos();
+                if (!parseSegment(tok.readLine(), coords)) {
+                    tok.error(where, "Expected a segment (x1,y1,z1)-(x2,y2,z2)");
+                }
+                segmentEdges(tok, where, coords, records.edges);
             }
+            tok.expect("!");
 
-            x1 = gcell1x;
-            y1 = gcell1y;
-            z1 = gcell1z;
-            x2 = gcell2x;
-            y2 = gcell2y;
-            z2 = gcell2z;
-
-            if (x1 != x2) {
-                for (unsigned j = min(x1, x2); j < max(x1, x2); ++j) {
-                    IdType edgeId = gcellArr3D[z1][y1][j].incX;
-                    assert(edgeId != NULLID);
-                    addSegment(net, grEdgeArr[edgeId]);
-                }
-            } else if (y1 != y2) {
-                for (unsigned j = min(y1, y2); j < max(y1, y2); ++j) {
-                    IdType edgeId = gcellArr3D[z1][j][x1].incY;
-                    assert(edgeId != NULLID);
-                    addSegment(net, grEdgeArr[edgeId]);
-                }
-            } else {
-                for (unsigned j = min(z1, z2); j < max(z1, z2); ++j) {
-                    IdType edgeId = gcellArr3D[j][y1][x1].incZ;
-                    assert(edgeId != NULLID);
-                    addSegment(net, grEdgeArr[edgeId]);
-                }
+            sort(records.edges.begin() + static_cast<ptrdiff_t>(first), records.edges.end());
+            records.edges.erase(unique(records.edges.begin() + static_cast<ptrdiff_t>(first), records.edges.end()),
+                records.edges.end());
+            records.nets.push_back(netId);
+            records.firstEdge.push_back(records.edges.size());
+        }
+    };
+
+    // Split the file at record boundaries. Small files are not worth a thread each.
+    const size_t minChunkBytes = 1 << 20;
+    const size_t numChunks = max<size_t>(1, min<size_t>(params.numThreads, file.size() / minChunkBytes));
+    vector<const char *> bounds(1, file.begin());
+    for (size_t i = 1; i < numChunks; ++i) {
+        const char *bound = nextRouteRecord(file.begin() + i * file.size() / numChunks, file.begin(), file.end());
+        if (bound > bounds.back()) bounds.push_back(bound);
+    }
+    bounds.push_back(file.end());
+
+    vector<RouteRecords> chunks(bounds.size() - 1);
+    PartErrors errors;
+    auto parseChunk = [&](size_t i) {
+        errors.run(i, [&]() {
+            Tokenizer tok(bounds[i], bounds[i + 1], file.begin(), fname);
+            parseRecords(tok, chunks[i]);
+        });
+    };
+    vector<thread> workers;
+    for (size_t i = 1; i < chunks.size(); ++i) { workers.emplace_back(parseChunk, i); }
+    parseChunk(0);
+    for (thread &worker : workers) { worker.join(); }
+    errors.rethrow();
+
+    for (const RouteRecords &records : chunks) {
+        for (size_t i = 0; i < records.nets.size(); ++i) {
+            // nets with both pins in one gcell need no routing, their segments are ignored
+            if (records.nets[i] & unroutableNetFlag) continue;
+            Net &net = grNetArr[records.nets[i]];
+            for (size_t j = records.firstEdge[i]; j < records.firstEdge[i + 1]; ++j) {
+                // a net may be listed more than once
+                Edge &edge = grEdgeArr[records.edges[j]];
+                if (!binary_search(edge.nets.begin(), edge.nets.end(), net.id)) { addSegment(net, edge); }
             }
+            net.routed = !net.runs.empty();
         }
+    }
+}
 
-        getline(infile, restofline);// the trailing !
+namespace {
+// appends `value' formatted the way ostream << formats a double by default (%g)
+void appendDouble(string &buf, double value)
+{
+    char tmp[32];
+    to_chars_result res = to_chars(tmp, tmp + sizeof(tmp), value, chars_format::general, 6);
+    buf.append(tmp, res.ptr);
+}
 
-        // read in the next one
-        infile >> netname;
+void appendUInt(string &buf, uint64_t value)
+{
+    char tmp[24];
+    to_chars_result res = to_chars(tmp, tmp + sizeof(tmp), value);
+    buf.append(tmp, res.ptr);
+}
+}// namespace
+
+//@brief: append the routes of nets [first, last) to `buf' in the output format
+void SimpleGR::formatRoutes(IdType first, IdType last, string &buf) const
+{
+    for (IdType i = first; i < last; ++i) {
+        const Net &net = grNetArr[i];
+        if (!net.routed) continue;
+
+        // every run of the route is one straight segment
+        assert(net.runs.size() > 0);
+
+        buf += netNameArr[i];
+        buf += ' ';
+        appendUInt(buf, netDBIdArr[i]);
+        buf += ' ';
+        appendUInt(buf, net.runs.size());
+        buf += '\n';
+        for (const RouteRun &run : net.runs) {
+            const pair<Point, Point> seg(*grEdgeArr[edgeOfRowMajorId(run.first)].gcell1,
+                *grEdgeArr[edgeOfRowMajorId(run.first + run.length - 1)].gcell2);
+            buf += '(';
+            appendDouble(buf, minX + gcellWidth * static_cast<double>(seg.first.x) + halfWidth);
+            buf += ',';
+            appendDouble(buf, minY + gcellHeight * static_cast<double>(seg.first.y) + halfHeight);
+            buf += ',';
+            appendUInt(buf, seg.first.z + 1);
+            buf += ")-(";
+            appendDouble(buf, minX + gcellWidth * static_cast<double>(seg.second.x) + halfWidth);
+            buf += ',';
+            appendDouble(buf, minY + gcellHeight * static_cast<double>(seg.second.y) + halfHeight);
+            buf += ',';
+            appendUInt(buf, seg.second.z + 1);
+            buf += ")\n";
+        }
+        buf += "!\n";
     }
 }
 
+//@brief: write the routes of all routed nets to params.outputFile. Nets are
+//        formatted in chunks by params.numThreads threads, started once, and
+//        the chunks are written in net order.
 void SimpleGR::writeRoutes()
 {
     if (params.outputFile.empty()) { return; }
     string filename = params.outputFile;
-    ofstream outfile(filename.c_str());
+    ofstream outfile(filename.c_str(), ios::binary);
 
     if (!outfile.good()) {
         cout << "Could not open `" << filename << "' for writing." << endl;
@@ -510,251 +630,116 @@ void SimpleGR::writeRoutes()
 
     cout << "Writing `" << filename << "' ..." << flush;
 
-    for (unsigned i = 0; i < grNetArr.size(); ++i) {
-        bool netRouted = grNetArr[i].routed;
-
-        if (netRouted) {
-            vector<unsigned> usedEdges(grNetArr[i].segments);
-
-            sort(usedEdges.begin(), usedEdges.end());
+    // Chunks are claimed in order and formatted into a ring of slots. Chunk c
+    // goes to slot c % numSlots once chunk c - numSlots has been written, which
+    // bounds the memory held by formatted routes.
+    const IdType netsPerChunk = 16384;
+    const IdType numNets = static_cast<IdType>(grNetArr.size());
+    const IdType numChunks = (numNets + netsPerChunk - 1) / netsPerChunk;
+    const IdType numSlots = 2 * params.numThreads;
+    vector<string> slots(numSlots);
+    vector<char> ready(numSlots, 0);
+    IdType nextChunk = 0, written = 0;
+    mutex lock;
+    condition_variable changed;
+
+    auto formatChunk = [&](IdType c) {
+        string &buf = slots[c % numSlots];
+        buf.clear();
+        formatRoutes(c * netsPerChunk, min(numNets, (c + 1) * netsPerChunk), buf);
+        {
+            lock_guard<mutex> guard(lock);
+            ready[c % numSlots] = 1;
+        }
+        changed.notify_all();
+    };
+    auto claimable = [&]() { return nextChunk < numChunks && nextChunk < written + numSlots; };
+    auto worker = [&]() {
+        for (;;) {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&]() { return nextChunk >= numChunks || claimable(); });
+            if (nextChunk >= numChunks) return;
+            const IdType c = nextChunk++;
+            guard.unlock();
+            formatChunk(c);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < params.numThreads; ++t) { workers.emplace_back(worker); }
+
+    // this thread writes the chunks in order, and formats chunks itself while
+    // the next one to write is not ready
+    for (IdType c = 0; c < numChunks; ++c) {
+        unique_lock<mutex> guard(lock);
+        while (!ready[c % numSlots]) {
+            if (claimable()) {
+                const IdType own = nextChunk++;
+                guard.unlock();
+                formatChunk(own);
+                guard.lock();
+            } else {
+                changed.wait(guard);
+            }
+        }
+        guard.unlock();
 
-            vector<pair<Point, Point>> segments;
+        const string &buf = slots[c % numSlots];
+        outfile.write(buf.data(), static_cast<streamsize>(buf.size()));
 
-            // add routed segments
-            assert(usedEdges.size() > 0);
-            Point startPt(*grEdgeArr[usedEdges[0]].gcell1);
-            Point endPt(*grEdgeArr[usedEdges[0]].gcell2);
-            for (unsigned j = 1; j < usedEdges.size(); ++j) {
-                unsigned prevEdge = usedEdges[j - 1];
-                unsigned currEdge = usedEdges[j];
+        guard.lock();
+        ready[c % numSlots] = 0;
+        ++written;
+        guard.unlock();
+        changed.notify_all();
+    }
+    for (thread &t : workers) { t.join(); }
 
-                if (grEdgeArr[prevEdge].type != grEdgeArr[currEdge].type
-                    || grEdgeArr[prevEdge].gcell2 != grEdgeArr[currEdge].gcell1) {
-                    segments.push_back(make_pair(startPt, endPt));
-                    startPt = *grEdgeArr[currEdge].gcell1;
-                    endPt = *grEdgeArr[currEdge].gcell2;
-                } else {
-                    endPt = *grEdgeArr[currEdge].gcell2;
-                }
-            }
-            segments.push_back(make_pair(startPt, endPt));
-
-            outfile << netNameArr[i] << " " << netDBIdArr[i] << " " << segments.size() << endl;
-            for (unsigned j = 0; j < segments.size(); ++j) {
-                outfile << "(" << minX + gcellWidth * static_cast<double>(segments[j].first.x) + halfWidth << ","
-                        << minY + gcellHeight * static_cast<double>(segments[j].first.y) + halfHeight;
-                outfile << "," << segments[j].first.z + 1;
-                outfile << ")-(" << minX + gcellWidth * static_cast<double>(segments[j].second.x) + halfWidth << ","
-                        << minY + gcellHeight * static_cast<double>(segments[j].second.y) + halfHeight;
-                outfile << "," << segments[j].second.z + 1;
-                outfile << ")" << endl;
-            }
-            outfile << "!" << endl;
-        }
+    outfile.close();
+    if (!outfile.good()) {
+        cout << " failed" << endl;
+        return;
     }
 
     cout << " done" << endl;
 }
 
-const char *coolMap[] = {
-    /* columns rows colors chars-per-pixel */
-    "a c #ffffff",
-    "b c #00009f",
-    "c c #0000af",
-    "d c #0000bf",
-    "e c #0000cf",
-    "f c #0000df",
-    "g c #0000ef",
-    "h c #0000ff",
-    "i c #000fff",
-    "j c #001fff",
-    "k c #002fff",
-    "l c #003fff",
-    "m c #004fff",
-    "n c #005fff",
-    "o c #006fff",
-    "p c #007fff",
-    "q c #008fff",
-    "r c #009fff",
-    "s c #00afff",
-    "t c #00bfff",
-    "u c #00cfff",
-    "v c #00dfff",
-    "w c #00efff",
-    "x c #00ffff",
-    "y c #0fffef",
-    "z c #1fffdf",
-    "A c #2fffcf",
-    "B c #3fffbf",
-    "C c #4fffaf",
-    "D c #5fff9f",
-    "E c #6fff8f",
-    "F c #7fff7f",
-    "G c #8fff6f",
-    "H c #9fff5f",
-    "I c #afff4f",
-    "J c #bfff3f",
-    "K c #cfff2f",
-    "L c #dfff1f",
-    "M c #efff0f",
-    "N c #ffff00",
-    "O c #ffef00",
-    "P c #ffdf00",
-    "Q c #ffcf00",
-    "R c #ffbf00",
-    "S c #ffaf00",
-    "T c #ff9f00",
-    "U c #ff8f00",
-    "V c #ff7f00",
-    "W c #ff6f00",
-    "X c #ff5f00",
-    "Y c #ff4f00",
-    "Z c #ff3f00",
-    "0 c #ff2f00",
-    "1 c #ff1f00",
-    "2 c #ff0f00",
-    "3 c #ff0000",
-    "4 c #ef0000",
-    "5 c #df0000",
-    "6 c #cf0000",
-    "7 c #bf0000",
-    "8 c #af0000",
-    "9 c #9f0000",
-    ", c #8f0000",
-    ". c #7f0000"
-};
-
-const char *Colors[] = { "a",
-    "b",
-    "c",
-    "d",
-    "e",
-    "f",
-    "g",
-    "h",
-    "i",
-    "j",
-    "k",
-    "l",
-    "m",
-    "n",
-    "o",
-    "p",
-    "q",
-    "r",
-    "s",
-    "t",
-    "u",
-    "v",
-    "w",
-    "x",
-    "y",
-    "z",
-    "A",
-    "B",
-    "C",
-    "D",
-    "E",
-    "F",
-    "G",
-    "H",
-    "I",
-    "J",
-    "K",
-    "L",
-    "M",
-    "N",
-    "O",
-    "P",
-    "Q",
-    "R",
-    "S",
-    "T",
-    "U",
-    "V",
-    "W",
-    "X",
-    "Y",
-    "Z",
-    "0",
-    "1",
-    "2",
-    "3",
-    "4",
-    "5",
-    "6",
-    "7",
-    "8",
-    "9",
-    ",",
-    "." };
-
+//@brief: plot the congestion of the whole grid as <filename>.xpm. Pixel (i, j)
+//        shows the average usage/capacity ratio of the wire edges leaving gcell
+//        (i, j) in x and in y direction, summed over all layers. The colors are
+//        scaled to the largest ratio.
 void SimpleGR::plotXPM(const string &filename)
 {
-    const unsigned numColors = 64;
-
-    string fullfilename = filename + string(".xpm");
-
-    ofstream xpmFile(fullfilename.c_str());
-
-    xpmFile << "/* XPM */" << endl;
-    xpmFile << "static char *congestion[] = {" << endl;
-    xpmFile << "/* columns rows colors chars-per-pixel */" << endl;
-    xpmFile << "\"" << gcellArrSzX - 1 << " " << gcellArrSzY - 1 << " " << numColors << " 1\"," << endl;
-    for (unsigned i = 0; i < numColors; ++i) xpmFile << "\"" << coolMap[i] << "\"," << endl;
-    xpmFile << "/* pixels */" << endl;
-
-    vector<vector<double>> image;
-
-    double maxRatio = 1.;
-
-    for (unsigned rj = 2; rj <= gcellArrSzY; ++rj) {
-        unsigned j = gcellArrSzY - rj;
-        vector<double> horizLine;
-        for (unsigned i = 0; i < gcellArrSzX - 1; ++i) {
-            double xUsage = 0., xCap = 0., yUsage = 0., yCap = 0.;
-            for (unsigned k = 0; k < gcellArr3D.size(); ++k) {
-                unsigned xEdgeId = gcellArr3D[k][j][i].incX;
-                unsigned yEdgeId = gcellArr3D[k][j][i].incY;
-
-                if (xEdgeId != UINT_MAX) {
-                    xUsage += grEdgeArr[xEdgeId].usage;
-                    xCap += grEdgeArr[xEdgeId].capacity;
-                }
-                if (yEdgeId != UINT_MAX) {
-                    yUsage += grEdgeArr[yEdgeId].usage;
-                    yCap += grEdgeArr[yEdgeId].capacity;
-                }
+    if (gcellArrSzX < 2 || gcellArrSzY < 2) return;
+
+    auto cellRatio = [this](unsigned i, unsigned j) {
+        double xUsage = 0., xCap = 0., yUsage = 0., yCap = 0.;
+        for (unsigned k = 0; k < numLayers; ++k) {
+            const GCell &gcell = gcellAt(i, j, k);
+            if (gcell.incX != NULLID) {
+                xUsage += grEdgeArr[gcell.incX].usage;
+                xCap += grEdgeArr[gcell.incX].capacity;
+            }
+            if (gcell.incY != NULLID) {
+                yUsage += grEdgeArr[gcell.incY].usage;
+                yCap += grEdgeArr[gcell.incY].capacity;
             }
-
-            double xRatio = static_cast<double>(xUsage) / static_cast<double>(xCap);
-            double yRatio = static_cast<double>(yUsage) / static_cast<double>(yCap);
-
-            double totalRatio = 0.5 * (xRatio + yRatio);
-
-            maxRatio = max(maxRatio, totalRatio);
-
-            horizLine.push_back(totalRatio);
         }
-        image.push_back(horizLine);
-    }
+        // edges blocked to zero capacity count as if they had a single track
+        return 0.5 * (xUsage / max(xCap, 1.) + yUsage / max(yCap, 1.));
+    };
 
+    // the ratios are cheap to compute, so do it twice instead of storing them
+    double maxRatio = 1.;
+    for (unsigned j = 0; j + 1 < gcellArrSzY; ++j) {
+        for (unsigned i = 0; i + 1 < gcellArrSzX; ++i) { maxRatio = max(maxRatio, cellRatio(i, j)); }
+    }
     cout << "maxratio was " << maxRatio << endl;
 
-    for (unsigned j = 0; j < gcellArrSzY - 1; ++j) {
-        xpmFile << "\"";
-        for (unsigned i = 0; i < gcellArrSzX - 1; ++i) {
-            unsigned index =
-                static_cast<unsigned>(floor((image[j][i] / maxRatio) * static_cast<double>(numColors - 1)));
-
-            xpmFile << Colors[index];
-        }
-        if (j == gcellArrSzY - 2) {
-            xpmFile << "\"" << endl;
-        } else {
-            xpmFile << "\"," << endl;
-        }
+    Heatmap map(filename, gcellArrSzX - 1, gcellArrSzY - 1);
+    for (unsigned row = 0; row < map.height; ++row) {
+        const unsigned j = map.height - 1 - row;
+        uint8_t *pixel = &map.pixels[static_cast<size_t>(row) * map.width];
+        for (unsigned i = 0; i < map.width; ++i) { pixel[i] = heatmapColor(cellRatio(i, j), maxRatio); }
     }
-    xpmFile << ");" << endl;
-    xpmFile.close();
+    writeHeatmapXPM(map);
 }
@@ -5,12 +5,135 @@
 
 #include "SimpleGR.h"
 
+namespace {
+// Cost policies of the maze search. The direction of a step tells whether it is a
+// via, so the kernel asks for wire and via costs separately and the cost type is
+// fixed at compile time.
+struct UnitCostPolicy
+{
+    const EdgeCost &func;
+    CostType wire(const Edge &) const { return func.Unit(); }
+    CostType via(void) const { return func.viaCost(); }
+};
+
+struct DLMCostPolicy
+{
+    const EdgeCost &func;
+    CostType wire(const Edge &edge) const { return func.DLM(edge); }
+    CostType via(void) const { return func.viaCost(); }
+};
+
+// Overflow policies, whether a search at `gcell' may not step in the direction
+// `dir' (a DirBit) across the edge `edgeId', NULLID where there is none
+struct AllowOverflow
+{
+    static bool blocked(const GCell &, uint8_t, IdType edgeId) { return edgeId == NULLID; }
+};
+
+// Forbids overflow, GCell::blockedDirs has the directions a wire would overflow
+struct ForbidOverflow
+{
+    static bool blocked(const GCell &gcell, uint8_t dir, IdType) { return (gcell.blockedDirs & dir) != 0; }
+};
+
+// Forbids overflow, except on the edges of the route being replaced, which it
+// frees: the edges whose sorted net list holds `netId'.
+struct ForbidOverflowBesides
+{
+    const vector<Edge> &edges;
+    IdType netId;
+    bool blocked(const GCell &gcell, uint8_t dir, IdType edgeId) const
+    {
+        if ((gcell.blockedDirs & dir) == 0) return false;
+        if (edgeId == NULLID) return true;
+        const IdList &nets = edges[edgeId].nets;
+        return !binary_search(nets.begin(), nets.end(), netId);
+    }
+};
+
+// The gcells a search may visit: the box [x0, x0 + width) x [y0, y0 + height)
+// on all layers. The search numbers them layer by layer and row by row, so the
+// queue entries of a search in a small box are packed at the start of PQueue
+// instead of being spread over the ids of the whole grid.
+struct SearchWindow
+{
+    CoordType x0, y0;
+    IdType width, height;
+
+    bool contains(const Point &p) const { return p.x >= x0 && p.x - x0 < width && p.y >= y0 && p.y - y0 < height; }
+    IdType index(CoordType x, CoordType y, CoordType z) const { return (z * height + y - y0) * width + x - x0; }
+    Point coord(IdType index) const
+    {
+        const IdType area = width * height, rest = index % area;
+        return Point(x0 + rest % width, y0 + rest / width, index / area);
+    }
+};
+
+// Bounding box policies. Boxes only constrain x and y, routeNet always passes
+// 0 for the z coordinates. window() is the smallest SearchWindow holding the box.
+struct FullGridBox
+{
+    static bool contains(CoordType, CoordType) { return true; }
+    static SearchWindow window(IdType sizeX, IdType sizeY) { return SearchWindow{ 0, 0, sizeX, sizeY }; }
+};
+
+struct BoundedBox
+{
+    Point botleft, topright;
+    bool contains(CoordType x, CoordType y) const
+    {
+        return botleft.x <= x && x <= topright.x && botleft.y <= y && y <= topright.y;
+    }
+    SearchWindow window(IdType sizeX, IdType sizeY) const
+    {
+        return SearchWindow{ botleft.x, botleft.y, min(topright.x + 1, sizeX) - botleft.x,
+            min(topright.y + 1, sizeY) - botleft.y };
+    }
+};
+
+// The tiles of the corridor of a coarse route, see SimpleGR::markCorridor
+struct CorridorBox
+{
+    const CoarseGrid &coarse;
+    bool contains(CoordType x, CoordType y) const
+    {
+        return coarse.corridor[(y / coarse.factor) * coarse.sizeX + x / coarse.factor] == coarse.corridorStamp;
+    }
+    SearchWindow window(IdType, IdType) const
+    {
+        const Point &low = coarse.corridorLow, &high = coarse.corridorHigh;
+        return SearchWindow{ low.x, low.y, high.x - low.x + 1, high.y - low.y + 1 };
+    }
+};
+
+// Heuristics, lower bounds of the cost from the gcell `id' at `p' to the destination.
+// The search keys its queue by the heuristic alone, a greedy best-first search
+// that expands few gcells but may settle for a costlier route.
+struct ManhattanHeuristic
+{
+    static constexpr bool orderByPathCost = false;
+    Point dest;
+    CostType operator()(IdType, const Point &p) const { return ManhattanCost()(p, dest); }
+};
+
+// The same heuristic, but the search keys its queue by path cost plus heuristic,
+// an A* search that finds the cheapest route, see params.astar
+template <class Heuristic>
+struct CheapestRoute : Heuristic
+{
+    static constexpr bool orderByPathCost = true;
+};
+}// namespace
+
 ///////////////////////////////////////////////////////////////////////////////
 // Implement an A* search based maze routing algorithm
 // and a corresponding back-trace procedure
 // The function needs to correctly deal with the following conditions:
 // 1. Only search within a bounding box defined by botleft and topright points
 // 2. Control if any overflow on the path is allowed or not
+//
+// This entry point picks the search kernel specialized for the cost function
+// type, the overflow constraint and whether the box covers the whole grid.
 ///////////////////////////////////////////////////////////////////////////////
 CostType SimpleGR::routeMaze(Net &net,
     bool allow_overflow,
@@ -19,62 +142,123 @@ CostType SimpleGR::routeMaze(Net &net,
     const EdgeCost &edge_cost,
     std::vector<Edge *> &path)
 {
-    // Get the ID of the source and destination cells
-    const IdType source_cell_id = getGCellId(net.gCellOne);
-    const IdType dest_cell_id = getGCellId(net.gCellTwo);
+    return routeMaze(net.gCellOne, net.gCellTwo, allow_overflow, bot_left, top_right, edge_cost, path);
+}
 
-    // Get a reference to the source cell (in order to get more information
-    // about the source cell)
-    const auto &dest_cell = getGCell(dest_cell_id);
+//@brief: the same search between two gcells that need not be the pins of a net
+CostType SimpleGR::routeMaze(const Point &source,
+    const Point &dest,
+    bool allow_overflow,
+    const Point &bot_left,
+    const Point &top_right,
+    const EdgeCost &edge_cost,
+    std::vector<Edge *> &path)
+{
+    const bool full_grid =
+        bot_left.x == 0 && bot_left.y == 0 && top_right.x + 1 >= gcellArrSzX && top_right.y + 1 >= gcellArrSzY;
+    if (full_grid) { return routeMazeIn(source, dest, allow_overflow, FullGridBox(), edge_cost, path); }
+    return routeMazeIn(source, dest, allow_overflow, BoundedBox{ bot_left, top_right }, edge_cost, path);
+}
+
+//@brief: search the whole grid for a route of `net'. With a coarse grid, long
+//        nets are searched in the corridor of their coarse route first, which
+//        grows by a tile on each side up to maxCorridorWiden times when no path
+//        is found in it.
+CostType SimpleGR::routeMazeWide(Net &net, bool allow_overflow, const EdgeCost &edge_cost, std::vector<Edge *> &path)
+{
+    const CoordType maxCorridorWiden = 2;
+    for (CoordType widen = 0; widen <= maxCorridorWiden && markCorridor(net, widen); ++widen) {
+        const CorridorBox corridor{ coarse };
+        const CostType cost = routeMazeIn(net.gCellOne, net.gCellTwo, allow_overflow, corridor, edge_cost, path);
+        if (!path.empty() || outOfTime()) return cost;
+    }
+    return routeMaze(net, allow_overflow, Point(0, 0, 0), Point(gcellArrSzX, gcellArrSzY, 0), edge_cost, path);
+}
+
+//@brief: pick the search kernel for the cost function type, the overflow
+//        constraint and the heuristic, with the search confined to `bbox'
+template <class BBoxPolicy>
+CostType SimpleGR::routeMazeIn(const Point &source,
+    const Point &dest,
+    bool allow_overflow,
+    const BBoxPolicy &bbox,
+    const EdgeCost &edge_cost,
+    std::vector<Edge *> &path)
+{
+    auto with_overflow = [&](const auto &cost, const auto &heuristic) {
+        if (allow_overflow) {
+            return routeMaze(source, dest, cost, AllowOverflow(), bbox, heuristic, priorityQueue, mazeExpansions, path);
+        }
+        return routeMaze(source, dest, cost, ForbidOverflow(), bbox, heuristic, priorityQueue, mazeExpansions, path);
+    };
+
+    if (edge_cost.getType() == EdgeCost::UnitCost) {
+        return with_overflow(UnitCostPolicy{ edge_cost }, ManhattanHeuristic{ dest });
+    }
+    if (cheapestRoutes) {
+        return with_overflow(DLMCostPolicy{ edge_cost }, CheapestRoute<ManhattanHeuristic>{ { dest } });
+    }
+    return with_overflow(DLMCostPolicy{ edge_cost }, ManhattanHeuristic{ dest });
+}
+
+//@brief: search a route for `net' on the whole grid that could replace its
+//        current one without overflow. The current route is not ripped up, its
+//        edges count as free. The search only reads the routing state, so
+//        searches with their own `queue' may run at the same time.
+CostType SimpleGR::routeMazeReplacing(const Net &net,
+    const EdgeCost &edge_cost,
+    PQueue &queue,
+    uint64_t &expansions,
+    vector<Edge *> &path)
+{
+    const ForbidOverflowBesides overflow{ grEdgeArr, net.id };
+    const ManhattanHeuristic heuristic{ net.gCellTwo };
+    if (edge_cost.getType() == EdgeCost::UnitCost) {
+        const UnitCostPolicy cost{ edge_cost };
+        return routeMaze(net.gCellOne, net.gCellTwo, cost, overflow, FullGridBox(), heuristic, queue, expansions, path);
+    }
+    const DLMCostPolicy cost{ edge_cost };
+    return routeMaze(net.gCellOne, net.gCellTwo, cost, overflow, FullGridBox(), heuristic, queue, expansions, path);
+}
+
+//@brief: the search kernel of routeMaze, A* or greedy best-first as the heuristic
+//        asks, see ManhattanHeuristic. The neighbors of a gcell are visited
+//        in the order incX, decX, incY, decY, incZ, decZ. The search keeps its
+//        state in `queue', indexed by the window of `bbox', and adds the gcells
+//        it expands to `expansion_count'.
+template <class CostPolicy, class OverflowPolicy, class BBoxPolicy, class Heuristic>
+CostType SimpleGR::routeMaze(const Point &source,
+    const Point &dest,
+    const CostPolicy &edge_cost,
+    const OverflowPolicy &overflow,
+    const BBoxPolicy &bbox,
+    const Heuristic &heuristic,
+    PQueue &queue,
+    uint64_t &expansion_count,
+    vector<Edge *> &path)
+{
+    // the queue holds the gcells of the box by their index in `window'
+    const SearchWindow window = bbox.window(gcellArrSzX, gcellArrSzY);
+    if (!window.contains(source) || !window.contains(dest)) { return std::numeric_limits<CostType>::max(); }
+    assert(static_cast<size_t>(window.width) * window.height * numLayers <= queue.capacity());
+    const IdType source_cell_id = window.index(source.x, source.y, source.z);
+    const IdType dest_cell_id = window.index(dest.x, dest.y, dest.z);
 
     // the priority queue keeps track of which cells are visited
     // insert the source cell to the priority queue to indicate that it has been visited
-    priorityQueue.setGCellCost(source_cell_id, 0., 0., NULLID);
+    queue.setGCellCost(source_cell_id, 0., 0., NULLID);
 
-    //@brief calculates the manhattan distance between two cells
+    //@brief calculates the manhattan distance between two cells, to size the path
     //  The `ManhattanCost` function object is defined in SimpleGR.h
-    ManhattanCost &manhattanDistance = ManhattanCost::getFunc();
-
-    //@brief checks if a cell is in the bounding box
-    //  Note: this function ignores the z-boundary, as when `routeMaze` is called
-    //  from SimpleGR `0` is always passed for the bot left and top right z-coords.
-    //
-    //@param cell The location of the cell to check
-    //@return Whether or not `cell` is in the bounding box
-    auto in_bounding_box = [&bot_left, &top_right](const Point &cell) {
-        return (bot_left.x <= cell.x && cell.x <= top_right.x) && (bot_left.y <= cell.y && cell.y <= top_right.y);
-    };
+    const ManhattanCost manhattanDistance{};
 
-    //@brief given a GCell and an edgeId returns the connecting GCell
-    //
-    // For example, if GCell 1 is connected to GCell 2 via edge 10, this function
-    // call would look like this:
-    //
-    // auto connected_cell = get_connecting_cell(GCell_1, Edge_10);
-    // assert(getGCellID(connected_cell) == 2);
-    auto get_connecting_cell = [this](const GCell &from, const IdType across_edge_id) -> GCell & {
-        const auto &edge = grEdgeArr[across_edge_id];
-        const auto *from_ptr = &from;
-        if (from_ptr == edge.gcell1) {
-            return *edge.gcell2;
-        } else {
-            return *edge.gcell1;
-        }
-    };
-
-    //@brief checks if we have reached the destination cell
-    //
-    //  this function is only written to provide readability, and it's expected
-    //  that it will be inlined at compile time
-    auto reached_destination = [&dest_cell_id](const IdType &cellId) { return dest_cell_id == cellId; };
+    // window index offsets of the neighbors
+    const IdType layer_size = window.width * window.height;
 
     //@brief Given two cells that are adjacent to one other, return a reference to
     //  the edge between the cells.
-    auto get_edge = [this](const IdType cell1_id, const IdType cell2_id) -> Edge & {
-        const auto &cell1 = getGCell(cell1_id);
-
-        const auto cell1_coord = gcellIdtoCoord(cell1_id);
-        const auto cell2_coord = gcellIdtoCoord(cell2_id);
+    auto get_edge = [this](const Point &cell1_coord, const Point &cell2_coord) -> Edge & {
+        const auto &cell1 = gcellAt(cell1_coord.x, cell1_coord.y, cell1_coord.z);
 
         IdType edgeId{};
 
@@ -104,18 +288,6 @@ CostType SimpleGR::routeMaze(Net &net,
         return edge;
     };
 
-    //@brief Checks if traversing an edge will cause overflow
-    auto causes_overflow = [this, &allow_overflow](const IdType edge_id) -> bool {
-        if (allow_overflow) { return false; }
-
-        const auto &edge = grEdgeArr[edge_id];
-        const CapType demand = (edge.type == VIA) ? 0 : minWidths[edge.layer] + minSpacings[edge.layer];
-
-        const auto will_overflow = (edge.usage + demand) > edge.capacity;
-
-        return will_overflow;
-    };
-
     // A* search algorithm
     //
     // The *best* cell in the priority queue is determined by the cell's "total cost", which
@@ -125,67 +297,80 @@ CostType SimpleGR::routeMaze(Net &net,
     // In a tradiional A* search you would only insert the single next best location from the
     // current location, but this implmentation inserts all the next possible locations from
     // current location
+    //
+    // Long searches give up once the deadline of the routing stage has passed. The
+    // clock is read only every so many expansions, reading it is not free.
+    const unsigned deadline_check_interval = 4096;
+    unsigned expansions = 0;
+    bool cancelled = false;
     do {
-        const auto this_cell_id = priorityQueue.getBestGCell();
-        const auto this_cell_data = priorityQueue.getGCellData(this_cell_id);
-
-        priorityQueue.rmBestGCell();
-
-        // if the current cell is the dest cell we can pop out of this loop
-        if (reached_destination(this_cell_id)) { break; }
-
-        // get all the edges from the current cell in order to look at the
-        // next possible cells
-        std::vector<IdType> edges;
-        {
-            const auto &this_cell = getGCell(this_cell_id);
-            edges = getConnectedEdges(this_cell);
+        if (++expansions % deadline_check_interval == 0 && outOfTime()) {
+            cancelled = true;
+            break;
         }
 
-        for (const auto &edgeId : edges) {
-
-            if (causes_overflow(edgeId)) { continue; }
+        const auto this_cell_id = queue.getBestGCell();
+        const CostType this_path_cost = queue.getGCellData(this_cell_id).pathCost;
 
-            // get references to the cell connected to the current cell by the current edge
-            const auto &this_cell = getGCell(this_cell_id);
-            const GCell &connecting_cell = get_connecting_cell(this_cell, edgeId);
+        queue.rmBestGCell();
 
-            // if the cell is out of the bounding box we can skip this loop
-            if (!in_bounding_box(connecting_cell)) { continue; }
+        // if the current cell is the dest cell we can pop out of this loop
+        if (this_cell_id == dest_cell_id) { break; }
+
+        const Point this_coord = window.coord(this_cell_id);
+        const GCell &this_cell = gcellAt(this_coord.x, this_coord.y, this_coord.z);
+
+        //@brief relaxes the step in direction `dir' across `edge_id' to the neighbor at (x, y, z)
+        auto visit = [&](uint8_t dir, IdType edge_id, bool is_via, IdType next_id, CoordType x, CoordType y,
+                         CoordType z) {
+            // skip directions without an edge (grid boundary, other layer or
+            // blocked), and full ones unless overflow is allowed
+            if (overflow.blocked(this_cell, dir, edge_id)) { return; }
+            if (!bbox.contains(x, y)) { return; }
+            const Edge &edge = grEdgeArr[edge_id];
+
+            // in a greedy search a gcell keeps the costs of its first visit: its
+            // queue key is the heuristic alone, which a later visit cannot lower.
+            // In an A* search a later visit may lower the key of a queued gcell.
+            if (queue.isGCellVsted(next_id) && !(Heuristic::orderByPathCost && queue.isGCellQueued(next_id))) {
+                return;
+            }
 
             // calculate the two types of cost
             // manh_cost : heuristic cost between the connecting cell and the destination
             // edge_cost : the cost from the source cell to the connecting cell
-            const auto manh_cost = manhattanDistance(connecting_cell, dest_cell);
-            const auto path_cost = edge_cost(edgeId) + this_cell_data.pathCost;
+            const auto manh_cost = heuristic(gcellCoordToId(x, y, z), Point(x, y, z));
+            const auto path_cost = (is_via ? edge_cost.via() : edge_cost.wire(edge)) + this_path_cost;
 
             // Calculate the total cost as detailed in the PQueue.setGCellCost function
             const auto total_cost = manh_cost + path_cost;
 
-            // get the connecting cell id to insert it into the priority queue
-            const auto connecting_cell_id = getGCellId(connecting_cell);
-
-            // insert the neighbor cell into the priority queue
-            if (!priorityQueue.isGCellVsted(connecting_cell_id)) {
-                priorityQueue.setGCellCost(connecting_cell_id, manh_cost, total_cost, this_cell_id);
+            if (Heuristic::orderByPathCost) {
+                queue.setGCellCost(next_id, total_cost, path_cost, this_cell_id);
             } else {
-                const auto old_cost = priorityQueue.getGCellData(connecting_cell_id).totalCost;
-                if (old_cost > total_cost) {
-                    priorityQueue.setGCellCost(connecting_cell_id, manh_cost, total_cost, this_cell_id);
-                }
+                queue.setGCellCost(next_id, manh_cost, total_cost, this_cell_id);
             }
-        }
-
-    } while (!priorityQueue.isEmpty());
+        };
+
+        const CoordType x = this_coord.x, y = this_coord.y, z = this_coord.z;
+        visit(INCX_BIT, this_cell.incX, false, this_cell_id + 1, x + 1, y, z);
+        visit(DECX_BIT, this_cell.decX, false, this_cell_id - 1, x - 1, y, z);
+        visit(INCY_BIT, this_cell.incY, false, this_cell_id + window.width, x, y + 1, z);
+        visit(DECY_BIT, this_cell.decY, false, this_cell_id - window.width, x, y - 1, z);
+        visit(INCZ_BIT, this_cell.incZ, true, this_cell_id + layer_size, x, y, z + 1);
+        visit(DECZ_BIT, this_cell.decZ, true, this_cell_id - layer_size, x, y, z - 1);
+    } while (!queue.isEmpty());
+    expansion_count += expansions;
 
     // now backtrace and build up the path, if we found one
     // back-track from sink to source, and fill up 'path' vector with all the edges that are traversed
-    if (priorityQueue.isGCellVsted(dest_cell_id)) {
+    const bool found = !cancelled && queue.isGCellVsted(dest_cell_id);
+    if (found) {
         auto current_id = dest_cell_id;
 
         // pre-allocate estimated space for the route path in order to minimize allocations
         {
-            const auto estimated_size = manhattanDistance(getGCell(source_cell_id), getGCell(dest_cell_id));
+            const auto estimated_size = manhattanDistance(source, dest);
             path.reserve(static_cast<std::size_t>(estimated_size) * 2);
         }
 
@@ -193,10 +378,10 @@ CostType SimpleGR::routeMaze(Net &net,
         path.clear();
 
         while (current_id != source_cell_id) {
-            const auto &current_node = priorityQueue.getGCellData(current_id);
+            const auto &current_node = queue.getGCellData(current_id);
             const auto parent_id = current_node.parentGCell;
 
-            auto &edge = get_edge(current_id, parent_id);
+            auto &edge = get_edge(window.coord(current_id), window.coord(parent_id));
             path.push_back(&edge);// this vector expects a pointer, for some reason
 
             current_id = parent_id;
@@ -204,12 +389,11 @@ CostType SimpleGR::routeMaze(Net &net,
     }
 
     // calculate the accumulated cost of the path
-    const CostType finalCost = priorityQueue.isGCellVsted(dest_cell_id)
-                                   ? priorityQueue.getGCellData(dest_cell_id).pathCost
-                                   : std::numeric_limits<CostType>::max();
+    const CostType finalCost =
+        found ? queue.getGCellData(dest_cell_id).pathCost : std::numeric_limits<CostType>::max();
 
     // clean up
-    priorityQueue.clear();
+    queue.clear();
 
     return finalCost;
 }
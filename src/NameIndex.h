@@ -0,0 +1,201 @@
+#ifndef _NAMEINDEX_H_
+#define _NAMEINDEX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//@brief: stores many short strings back to back in one buffer. String i is
+//        [bytes + offsets[i], bytes + offsets[i + 1]). The arena either owns its
+//        storage, or is a view over storage that lives elsewhere (e.g. a mapped
+//        design cache). Adding to a view copies it into owned storage first.
+class NameArena
+{
+  public:
+    NameArena() : base_(NULL), offs_(NULL), size_(0) {}
+    NameArena(const NameArena &orig) : base_(NULL), offs_(NULL), size_(0) { *this = orig; }
+    NameArena &operator=(const NameArena &assign)
+    {
+        if (this != &assign) {
+            bytes_ = assign.bytes_;
+            offsets_ = assign.offsets_;
+            size_ = assign.size_;
+            if (assign.isView()) {
+                base_ = assign.base_;
+                offs_ = assign.offs_;
+            } else {
+                sync();
+            }
+        }
+        return *this;
+    }
+
+    size_t size(void) const { return size_; }
+    bool empty(void) const { return size_ == 0; }
+    std::string_view operator[](size_t i) const
+    {
+        return std::string_view(base_ + offs_[i], offs_[i + 1] - offs_[i]);
+    }
+
+    void reserve(size_t names, size_t bytes)
+    {
+        own();
+        offsets_.reserve(names + 1);
+        bytes_.reserve(bytes);
+        sync();
+    }
+    // appends `name', returns its index
+    size_t add(std::string_view name)
+    {
+        own();
+        bytes_.insert(bytes_.end(), name.begin(), name.end());
+        offsets_.push_back(bytes_.size());
+        sync();
+        return size_++;
+    }
+    void clear(void)
+    {
+        bytes_.clear();
+        offsets_.assign(1, 0);
+        size_ = 0;
+        sync();
+    }
+    // make this arena a view of `count' strings stored elsewhere. The storage has
+    // to outlive the view.
+    void attach(const char *bytes, const uint64_t *offsets, size_t count)
+    {
+        bytes_.clear();
+        offsets_.clear();
+        base_ = bytes;
+        offs_ = offsets;
+        size_ = count;
+    }
+
+  private:
+    std::vector<char> bytes_;
+    std::vector<uint64_t> offsets_;
+    // what the strings are read from, either the vectors above or external storage
+    const char *base_;
+    const uint64_t *offs_;
+    size_t size_;
+
+    bool isView(void) const { return offs_ != NULL && offsets_.empty(); }
+    void sync(void)
+    {
+        if (offsets_.empty()) offsets_.push_back(0);
+        base_ = bytes_.data();
+        offs_ = offsets_.data();
+    }
+    // copy a view into owned storage
+    void own(void)
+    {
+        if (!isView()) {
+            sync();
+            return;
+        }
+        const uint64_t first = offs_[0];
+        bytes_.assign(base_ + first, base_ + offs_[size_]);
+        offsets_.resize(size_ + 1);
+        for (size_t i = 0; i <= size_; ++i) offsets_[i] = offs_[i] - first;
+        sync();
+    }
+};
+
+//@brief: open addressing (linear probing) hash index from names to 32 bit values.
+//        The names themselves are not stored. Lookups take a functor that returns
+//        the name of a stored value, typically a NameArena lookup.
+class NameIndex
+{
+  public:
+    static const uint32_t NOTFOUND = 0xffffffffU;
+
+    NameIndex() : mask_(0), size_(0) {}
+
+    bool empty(void) const { return size_ == 0; }
+    void clear(void)
+    {
+        slots_.clear();
+        mask_ = 0;
+        size_ = 0;
+    }
+    // allocate room for `count' names, the index stays at most half full
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < 2 * count) capacity <<= 1;
+        if (capacity > slots_.size()) rehash(capacity);
+    }
+
+    // maps `name' to `value'. If `name' is indexed already, its value is replaced.
+    template<typename NameOf>
+    void insert(std::string_view name, uint32_t value, NameOf nameOf)
+    {
+        if (2 * (size_ + 1) > slots_.size()) rehash(slots_.empty() ? 16 : 2 * slots_.size());
+        const uint32_t tag = hash(name);
+        for (size_t i = tag & mask_;; i = (i + 1) & mask_) {
+            Slot &slot = slots_[i];
+            if (slot.value == NOTFOUND) {
+                slot.tag = tag;
+                slot.value = value;
+                ++size_;
+                return;
+            }
+            if (slot.tag == tag && nameOf(slot.value) == name) {
+                slot.value = value;
+                return;
+            }
+        }
+    }
+
+    // returns the value `name' maps to, or NOTFOUND
+    template<typename NameOf>
+    uint32_t find(std::string_view name, NameOf nameOf) const
+    {
+        if (slots_.empty()) return NOTFOUND;
+        const uint32_t tag = hash(name);
+        for (size_t i = tag & mask_;; i = (i + 1) & mask_) {
+            const Slot &slot = slots_[i];
+            if (slot.value == NOTFOUND) return NOTFOUND;
+            if (slot.tag == tag && nameOf(slot.value) == name) return slot.value;
+        }
+    }
+
+  private:
+    struct Slot
+    {
+        uint32_t tag;// the name's hash. It picks the slot and skips most string compares
+        uint32_t value;
+    };
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t size_;
+
+    // 64 bit FNV-1a, folded to 32 bits with a final mix so that the low bits are usable as slot index
+    static uint32_t hash(std::string_view name)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : name) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 32;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        return static_cast<uint32_t>(h >> 32);
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.assign(capacity, Slot { 0, NOTFOUND });
+        mask_ = capacity - 1;
+        for (const Slot &slot : old) {
+            if (slot.value == NOTFOUND) continue;
+            size_t i = slot.tag & mask_;
+            while (slots_[i].value != NOTFOUND) i = (i + 1) & mask_;
+            slots_[i] = slot;
+        }
+    }
+};
+
+#endif
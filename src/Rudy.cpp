@@ -0,0 +1,113 @@
+/*
+ * Rudy.cpp
+ * Congestion estimate ahead of initial routing (RUDY, rectangular uniform wire
+ * density). The wire a net needs is spread evenly over its bounding box: its
+ * horizontal length over the rows of the box and its vertical length over the
+ * columns. Summed over all nets with 2D difference arrays, this gives the
+ * expected usage of every edge in time linear in the nets and the gcells.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "SimpleGR.h"
+
+namespace {
+// history cost added per unit of expected overflow ratio, and its maximum
+const double rudyHistoryWeight = 1.;
+const double rudyMaxHistory = 4.;
+
+// turn the difference array `a' (width x height) into its 2D prefix sums
+template <class T>
+void prefixSums(vector<T> &a, size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            if (x > 0) a[y * width + x] += a[y * width + x - 1];
+            if (y > 0) a[y * width + x] += a[(y - 1) * width + x];
+            if (x > 0 && y > 0) a[y * width + x] -= a[(y - 1) * width + x - 1];
+        }
+    }
+}
+}// namespace
+
+//@brief: estimate the congestion of every edge from the bounding boxes of the
+//        nets. Edges expected to overflow start with a higher history cost, so
+//        that initial routing already avoids them.
+//@ret:   the nets in the order initial routing should take them
+vector<IdType> SimpleGR::estimateCongestion(void)
+{
+    const size_t width = gcellArrSzX + 1, height = gcellArrSzY + 1;
+    auto box = [](const Net &net, CoordType &x0, CoordType &y0, CoordType &x1, CoordType &y1) {
+        x0 = min(net.gCellOne.x, net.gCellTwo.x);
+        x1 = max(net.gCellOne.x, net.gCellTwo.x);
+        y0 = min(net.gCellOne.y, net.gCellTwo.y);
+        y1 = max(net.gCellOne.y, net.gCellTwo.y);
+    };
+
+    // expected wires across the edge from gcell (x, y) to (x + 1, y), and to (x, y + 1)
+    vector<double> horiz(width * height, 0.), vert(width * height, 0.);
+    auto addBox = [width](vector<double> &a, CoordType x0, CoordType y0, CoordType x1, CoordType y1, double v) {
+        a[y0 * width + x0] += v;
+        a[y0 * width + x1 + 1] -= v;
+        a[(y1 + 1) * width + x0] -= v;
+        a[(y1 + 1) * width + x1 + 1] += v;
+    };
+    for (IdType netId : netOrder) {
+        CoordType x0, y0, x1, y1;
+        box(grNetArr[netId], x0, y0, x1, y1);
+        if (x1 > x0) addBox(horiz, x0, y0, x1 - 1, y1, 1. / (y1 - y0 + 1));
+        if (y1 > y0) addBox(vert, x0, y0, x1, y1 - 1, 1. / (x1 - x0 + 1));
+    }
+    prefixSums(horiz, width, height);
+    prefixSums(vert, width, height);
+
+    // expected usage over capacity of the edges, and the larger of the two at
+    // each gcell for the net order
+    // buildGrid puts horizontal wires on layer 0 and vertical ones on layer 1
+    const double horizDemand = minWidths[0] + minSpacings[0], vertDemand = minWidths[1] + minSpacings[1];
+    vector<double> congestion(width * height, 0.);
+    unsigned hotEdges = 0;
+    auto seed = [&](IdType edgeId, double wires, double demand) {
+        if (edgeId == NULLID) return 0.;
+        Edge &edge = grEdgeArr[edgeId];
+        const double ratio = wires * demand / max<double>(edge.capacity, 1.);
+        if (ratio > 1.) {
+            const double extra = min(rudyHistoryWeight * (ratio - 1.), rudyMaxHistory);
+            edge.historyCost += static_cast<CostType>(extra);
+            ++hotEdges;
+        }
+        return ratio;
+    };
+    for (CoordType y = 0; y < gcellArrSzY; ++y) {
+        for (CoordType x = 0; x < gcellArrSzX; ++x) {
+            const size_t i = y * width + x;
+            const double h = seed(gcellAt(x, y, 0).incX, horiz[i], horizDemand);
+            const double v = seed(gcellAt(x, y, 1).incY, vert[i], vertDemand);
+            congestion[(y + 1) * width + x + 1] = max(h, v);
+        }
+    }
+    prefixSums(congestion, width, height);
+
+    // nets in more congested boxes first, by the mean estimate over the box: they
+    // have the fewest ways around and take them while there is capacity left.
+    // Nets with the same estimate keep the order of netOrder.
+    vector<pair<double, IdType>> keys;
+    keys.reserve(netOrder.size());
+    for (IdType netId : netOrder) {
+        CoordType x0, y0, x1, y1;
+        box(grNetArr[netId], x0, y0, x1, y1);
+        const double sum = congestion[(y1 + 1) * width + x1 + 1] - congestion[y0 * width + x1 + 1]
+                           - congestion[(y1 + 1) * width + x0] + congestion[y0 * width + x0];
+        const double mean = sum / ((x1 - x0 + 1.) * (y1 - y0 + 1.));
+        keys.push_back(make_pair(-mean, netId));
+    }
+    stable_sort(keys.begin(), keys.end(),
+        [](const pair<double, IdType> &a, const pair<double, IdType> &b) { return a.first < b.first; });
+    vector<IdType> order;
+    order.reserve(keys.size());
+    for (const pair<double, IdType> &key : keys) { order.push_back(key.second); }
+
+    cout << "congestion estimate: " << hotEdges << " edge(s) expected to overflow" << endl;
+    return order;
+}
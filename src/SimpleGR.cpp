@@ -1,51 +1,250 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace std;
 
 #include "SimpleGR.h"
 
-//@brief: This functor compares two nets by their bounding boxes. The one with
-//        shorter perimeter and smaller aspect ratio is considered less.
-//@param: Two net IDs
-bool CompareByBox::operator()(const IdType a, const IdType b) const
+// Shares of params.budget, counted from the start of the flow, by which the
+// stages have to end. Time a stage does not use is left to the later ones.
+const double initialBudgetShare = 0.5;
+const double rrrBudgetShare = 0.9;
+
+// RRR reroutes routes of at least partialRipMinEdges edges around their overflow
+// only, see rerouteAroundOverflow. partialRipSlack edges on both sides of the
+// overflowing ones are ripped up as well, and the search reconnecting the cut
+// points may leave their bounding box by partialRipMargin gcells.
+const size_t partialRipMinEdges = 16;
+const size_t partialRipSlack = 2;
+const CoordType partialRipMargin = 3;
+
+// Greedy improvement searches this many nets against the same routes before it
+// commits them. The batches do not depend on the number of threads, neither do
+// the results.
+const size_t greedyBatchSize = 256;
+// Every greedy worker but the first needs a search queue over the whole grid.
+// There are at most maxGreedyWorkers of them, fewer if their queues would take
+// more than greedyQueueBudget bytes.
+const unsigned maxGreedyWorkers = 8;
+const size_t greedyQueueBudget = size_t(256) << 20;
+
+namespace {
+// Sets the knobs of the RRR iterations from the progress of the earlier ones.
+// An iteration that cuts the overflow by less than slowProgress raises the
+// history increment, so that nets give up the edges they keep fighting over;
+// one that cuts it by more than fastProgress lowers it back towards the
+// default. The effort level sets where nets are rerouted: while the overflow
+// is above fullGridOverflow, in their bounding box at level 0, in the box grown
+// by boxMarginStep gcells on each side at level 1, and on the whole grid at
+// level 2, as at any level once the overflow is low. The level goes up by one
+// whenever an iteration makes no progress. Progress is a new lowest overflow
+// or a new lowest number of nets to rip up. The state is not saved in
+// checkpoints, a resumed RRR starts over from the defaults.
+class RRRController
 {
-    // Reference nets without boundary check
-    const Net &neta = (*p_nets_)[a];
-    const Net &netb = (*p_nets_)[b];
-    // Reference the ending points on nets a and b
-    const Point &aOne = neta.gCellOne;
-    const Point &bOne = netb.gCellOne;
-    const Point &aTwo = neta.gCellTwo;
-    const Point &bTwo = netb.gCellTwo;
-
-    // net A's measurements
-    CostType aWidth = static_cast<CostType>(abs(static_cast<CostType>(aOne.x) - static_cast<CostType>(aTwo.x)));
-    CostType aHeight = static_cast<CostType>(abs(static_cast<CostType>(aOne.y) - static_cast<CostType>(aTwo.y)));
-    pair<CostType, CostType> costA(aWidth + aHeight, min(aWidth, aHeight) / max(aWidth, aHeight));
-    // net B's measurements
-    CostType bWidth = static_cast<CostType>(abs(static_cast<CostType>(bOne.x) - static_cast<CostType>(bTwo.x)));
-    CostType bHeight = static_cast<CostType>(abs(static_cast<CostType>(bOne.y) - static_cast<CostType>(bTwo.y)));
-    pair<CostType, CostType> costB(bWidth + bHeight, min(bWidth, bHeight) / max(bWidth, bHeight));
-
-    return costA < costB;
+  public:
+    RRRController(unsigned overflow, unsigned stallLimit)
+        : historyIncrement(::historyIncrement), effort(0), stallLimit_(stallLimit), stalled_(0),
+          prevOverflow_(overflow), bestOverflow_(overflow), bestNets_(numeric_limits<size_t>::max())
+    {}
+
+    //@brief: whether nets are rerouted on the whole grid while the total overflow is `overflow'
+    bool fullGrid(unsigned overflow) const { return effort == fullGridEffort || overflow <= fullGridOverflow; }
+    //@brief: the gcells the box of a bounded reroute extends beyond the net's bounding box
+    CoordType boxMargin(void) const { return effort * boxMarginStep; }
+
+    //@brief: account for an iteration that ended with `overflow' after ripping up `nets' nets
+    //@ret:   false if RRR should end, as it has not made progress for stallLimit iterations
+    bool update(unsigned overflow, size_t nets)
+    {
+        const double gain = prevOverflow_ > 0 ? (double(prevOverflow_) - overflow) / prevOverflow_ : 0.;
+        if (gain < slowProgress) {
+            historyIncrement = min(historyIncrement * 1.5f, maxHistoryScale * ::historyIncrement);
+        } else if (gain > fastProgress) {
+            historyIncrement = max(historyIncrement / 1.5f, ::historyIncrement);
+        }
+        prevOverflow_ = overflow;
+
+        if (overflow < bestOverflow_ || nets < bestNets_) {
+            stalled_ = 0;
+        } else {
+            ++stalled_;
+        }
+        bestOverflow_ = min(bestOverflow_, overflow);
+        bestNets_ = min(bestNets_, nets);
+
+        if (effort < fullGridEffort && stalled_ > 0) {
+            ++effort;
+            stalled_ = 0;
+        }
+        return stallLimit_ == 0 || stalled_ < stallLimit_;
+    }
+
+    CostType historyIncrement;// added to the history cost of overflowing edges
+    unsigned effort;// the effort level, from 0 to fullGridEffort
+
+  private:
+    static constexpr unsigned fullGridEffort = 2, fullGridOverflow = 500;
+    static constexpr CoordType boxMarginStep = 5;
+    static constexpr double slowProgress = 0.02, fastProgress = 0.2;
+    static constexpr CostType maxHistoryScale = 4.f;
+    unsigned stallLimit_, stalled_;
+    unsigned prevOverflow_, bestOverflow_;
+    size_t bestNets_;
+};
+
+// the cost of the route of `net' under the unit cost function `uc'
+CostType unitRouteCost(const Net &net, const EdgeCost &uc)
+{
+    return uc.Unit() * static_cast<CostType>(net.numSegments) + uc.viaCost() * static_cast<CostType>(net.numVias);
+}
+}// namespace
+
+//@brief: set the deadline of the stage that starts now. It is budgetShare of the
+//        total budget after the start of the flow, and at most stageLimit seconds
+//        from now if stageLimit is positive.
+void SimpleGR::setStageDeadline(double budgetShare, double stageLimit)
+{
+    auto seconds = [](double s) { return chrono::duration_cast<Clock::duration>(chrono::duration<double>(s)); };
+    stageDeadline = Clock::time_point::max();
+    if (params.budget > 0.) { stageDeadline = flowStart + seconds(budgetShare * params.budget); }
+    if (stageLimit > 0.) { stageDeadline = min(stageDeadline, Clock::now() + seconds(stageLimit)); }
+}
+
+//@brief: commit `route' again after a reroute of the net was cut short by the deadline
+void SimpleGR::restoreRoute(Net &net, const vector<RouteRun> &route)
+{
+    for (const RouteRun &run : route) { addRun(net, run); }
+    net.routed = !route.empty();
+}
+
+//@brief: copy the routes of all nets to `snapshot'
+void SimpleGR::saveRoutes(RouteSnapshot &snapshot) const
+{
+    snapshot.firstRun.resize(grNetArr.size() + 1);
+    snapshot.runs.clear();
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        snapshot.firstRun[i] = static_cast<IdType>(snapshot.runs.size());
+        snapshot.runs.insert(snapshot.runs.end(), grNetArr[i].runs.begin(), grNetArr[i].runs.end());
+    }
+    snapshot.firstRun[grNetArr.size()] = static_cast<IdType>(snapshot.runs.size());
+    snapshot.totalOverflow = totalOverflow;
+}
+
+//@brief: commit the routes of `snapshot' again. Only the nets whose route has
+//        changed since are ripped up.
+void SimpleGR::restoreRoutes(const RouteSnapshot &snapshot)
+{
+    vector<RouteRun> route;
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        const RouteRun *first = snapshot.runs.data() + snapshot.firstRun[i];
+        const RouteRun *last = snapshot.runs.data() + snapshot.firstRun[i + 1];
+        const RunList &runs = grNetArr[i].runs;
+        auto sameRun = [](const RouteRun &a, const RouteRun &b) { return a.first == b.first && a.length == b.length; };
+        if (equal(runs.begin(), runs.end(), first, last, sameRun)) continue;
+        route.assign(first, last);
+        ripUpNet(i);
+        restoreRoute(grNetArr[i], route);
+    }
+    assert(totalOverflow == snapshot.totalOverflow);
+}
+
+//@brief: append the edges of the straight path from `from' to `to', which differ
+//        in one coordinate only
+//@ret:   false if the path crosses a missing or blocked edge
+bool SimpleGR::appendStraightPath(const Point &from, const Point &to, vector<IdType> &edges) const
+{
+    Point cur = from;
+    while (cur != to) {
+        const GCell &gcell = gcellAt(cur.x, cur.y, cur.z);
+        IdType edgeId = NULLID;
+        if (cur.x != to.x) {
+            edgeId = cur.x < to.x ? gcell.incX : gcell.decX;
+            cur.x = cur.x < to.x ? cur.x + 1 : cur.x - 1;
+        } else if (cur.y != to.y) {
+            edgeId = cur.y < to.y ? gcell.incY : gcell.decY;
+            cur.y = cur.y < to.y ? cur.y + 1 : cur.y - 1;
+        } else {
+            edgeId = cur.z < to.z ? gcell.incZ : gcell.decZ;
+            cur.z = cur.z < to.z ? cur.z + 1 : cur.z - 1;
+        }
+        if (edgeId == NULLID) return false;
+        edges.push_back(edgeId);
+    }
+    return true;
+}
+
+//@brief: route a net on one of its two L shapes without looking at congestion.
+//        This is what initial routing falls back to once its time is up, so that
+//        every net gets a route. If blocked edges are in the way of both shapes,
+//        the net is maze routed without a deadline.
+void SimpleGR::routeNetPattern(Net &net)
+{
+    // buildGrid puts horizontal wires on layer 0 and vertical ones on layer 1
+    const CoordType horizLayer = 0, vertLayer = 1;
+    const Point &one = net.gCellOne;
+    const Point &two = net.gCellTwo;
+
+    vector<IdType> edges;
+    for (unsigned shape = 0; shape < 2 && !net.routed; ++shape) {
+        // the corners the route passes, pins first and last
+        vector<Point> corners(1, one);
+        const bool horizFirst = (shape == 0);
+        for (unsigned leg = 0; leg < 2; ++leg) {
+            const Point from = corners.back();
+            if ((leg == 0) == horizFirst) {
+                if (from.x == two.x) continue;
+                corners.push_back(Point(from.x, from.y, horizLayer));
+                corners.push_back(Point(two.x, from.y, horizLayer));
+            } else {
+                if (from.y == two.y) continue;
+                corners.push_back(Point(from.x, from.y, vertLayer));
+                corners.push_back(Point(from.x, two.y, vertLayer));
+            }
+        }
+        corners.push_back(two);
+
+        edges.clear();
+        bool legal = true;
+        for (size_t i = 1; i < corners.size() && legal; ++i) {
+            legal = appendStraightPath(corners[i - 1], corners[i], edges);
+        }
+        if (!legal) continue;
+
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+        for (IdType edgeId : edges) { addSegment(net, grEdgeArr[edgeId]); }
+        net.routed = true;
+    }
+
+    if (!net.routed) {
+        const Clock::time_point deadline = stageDeadline;
+        stageDeadline = Clock::time_point::max();
+        const bool allowOverflow = true;
+        const bool nobboxConstrain = false;
+        routeNet(net, allowOverflow, nobboxConstrain, EdgeCost(this, EdgeCost::DLMCost));
+        stageDeadline = deadline;
+    }
 }
 
 //@brief: Look for all "flat" nets, sort them from small to large
 //        and route them with a bounding box constraint
-//@param: Overflow constraint, EdgeCost functor ref
-void SimpleGR::routeFlatNets(bool allowOverflow, const EdgeCost &func)
+//@param: the nets in routing order, Overflow constraint, EdgeCost functor ref
+void SimpleGR::routeFlatNets(const vector<IdType> &order, bool allowOverflow, const EdgeCost &func)
 {
     unsigned flatNetsRouted = 0;
     const bool bboxConstrain = true;
 
-    // Collect the 'flat' nets
+    // Collect the 'flat' nets in the given order
     vector<IdType> netIdVec;
-    for (IdType i = 0; i < grNetArr.size(); ++i) {
+    for (IdType i : order) {
         Net &net = grNetArr[i];
         if (net.gCellOne.x == net.gCellTwo.x || net.gCellOne.y == net.gCellTwo.y) {
             // count it flat if straight horizontal or vertical
@@ -53,9 +252,6 @@ void SimpleGR::routeFlatNets(bool allowOverflow, const EdgeCost &func)
         }
     }
 
-    // Sort nets with bounding box sizes. Smaller goes first
-    sort(netIdVec.begin(), netIdVec.end(), CompareByBox(&grNetArr));
-
     // iterator over all collected nets
     SimpleProgRpt report(netIdVec.size());
     for (unsigned i = 0; i < netIdVec.size(); ++i) {
@@ -65,6 +261,8 @@ void SimpleGR::routeFlatNets(bool allowOverflow, const EdgeCost &func)
         Net &net = grNetArr[netIdVec[i]];
 
         if (net.routed) continue;
+        // out of time, routeNets takes the remaining nets
+        if (outOfTime()) break;
 
         if (params.verbose) {
             printf("routing flat GR net Id %d. ", net.id);
@@ -92,68 +290,196 @@ void SimpleGR::routeFlatNets(bool allowOverflow, const EdgeCost &func)
 //        routed with any path that causes overflow, or it fails to route.
 //        Bounding box constraint is soft. This function will try its best to route
 //        within the bounded area, but if that fails then it will remove the constraint.
-//@param: The net to be routed, boolean constraints: overflow and bounding box, and EdgeCost functor ref
+//@param: The net to be routed, boolean constraints: overflow and bounding box, EdgeCost functor ref,
+//        and the gcells the bounding box is grown by on each side
 //@ret:   If net's routed, it returns the cost of the route. Otherwise an undefined value is returned
-CostType SimpleGR::routeNet(Net &net, bool allowOverflow, bool bboxConstrain, const EdgeCost &costfunc)
+CostType SimpleGR::routeNet(Net &net, bool allowOverflow, bool bboxConstrain, const EdgeCost &costfunc,
+    CoordType boxMargin)
 {
     vector<Edge *> routePath;
     CostType totalCost;
 
     if (bboxConstrain) {
-        const Point botleft(min(net.gCellOne.x, net.gCellTwo.x), min(net.gCellOne.y, net.gCellTwo.y), 0);
-        const Point topright(max(net.gCellOne.x, net.gCellTwo.x), max(net.gCellOne.y, net.gCellTwo.y), 0);
+        auto lower = [boxMargin](CoordType a, CoordType b) {
+            return min(a, b) > boxMargin ? min(a, b) - boxMargin : 0;
+        };
+        const Point botleft(lower(net.gCellOne.x, net.gCellTwo.x), lower(net.gCellOne.y, net.gCellTwo.y), 0);
+        const Point topright(min(max(net.gCellOne.x, net.gCellTwo.x) + boxMargin, gcellArrSzX - 1),
+            min(max(net.gCellOne.y, net.gCellTwo.y) + boxMargin, gcellArrSzY - 1), 0);
         totalCost = routeMaze(net, false, botleft, topright, costfunc, routePath);
         if (routePath.empty()) {
             // if not possible, relax the bounding box constraints to find a feasible path
-            totalCost =
-                routeMaze(net, allowOverflow, Point(0, 0, 0), Point(gcellArrSzX, gcellArrSzY, 0), costfunc, routePath);
+            totalCost = routeMazeWide(net, allowOverflow, costfunc, routePath);
         }
     } else {
-        totalCost =
-            routeMaze(net, allowOverflow, Point(0, 0, 0), Point(gcellArrSzX, gcellArrSzY, 0), costfunc, routePath);
+        totalCost = routeMazeWide(net, allowOverflow, costfunc, routePath);
     }
 
     net.routed = (routePath.size() > 0);
     if (net.routed) {
-        for (unsigned i = 0; i < routePath.size(); ++i) { addSegment(net, *routePath[i]); }
+        addPath(net, routePath);
     }
 
     return totalCost;
 }
 
+//@brief: reroute the part of a long route around its overflowing edges only. The
+//        route is cut partialRipSlack edges before the first and after the last
+//        of them, and a maze search in a box around the two cut points reconnects
+//        them without overflow. The rest of the route stays committed.
+//@ret:   false, with the route unchanged, if the route is short or not a simple
+//        path from pin to pin, if the overflow spans most of it, or if no path
+//        is found that stays clear of overflow and of the kept parts
+bool SimpleGR::rerouteAroundOverflow(Net &net, const EdgeCost &func)
+{
+    const size_t routeSize = net.numSegments + net.numVias;
+    if (!net.routed || routeSize < partialRipMinEdges) return false;
+
+    // walk the route from gCellOne, cells[i] and cells[i + 1] are the ends of edges[i]
+    typedef pair<IdType, IdType> CellEdge;
+    vector<IdType> route;
+    route.reserve(routeSize);
+    routeEdges(net, route);
+    vector<CellEdge> ends;
+    ends.reserve(2 * routeSize);
+    for (IdType edgeId : route) {
+        const Edge &edge = grEdgeArr[edgeId];
+        ends.push_back(make_pair(getGCellId(*edge.gcell1), edgeId));
+        ends.push_back(make_pair(getGCellId(*edge.gcell2), edgeId));
+    }
+    sort(ends.begin(), ends.end());
+    auto byCell = [](const CellEdge &a, const CellEdge &b) { return a.first < b.first; };
+
+    vector<IdType> cells(1, getGCellId(net.gCellOne)), edges;
+    for (IdType prevEdge = NULLID; edges.size() <= routeSize;) {
+        const auto range = equal_range(ends.begin(), ends.end(), make_pair(cells.back(), NULLID), byCell);
+        if (range.second - range.first > 2) return false;// the route branches
+        IdType nextEdge = NULLID;
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second != prevEdge) nextEdge = it->second;
+        }
+        if (nextEdge == NULLID) break;
+        const Edge &edge = grEdgeArr[nextEdge];
+        const IdType cell1 = getGCellId(*edge.gcell1);
+        cells.push_back(cell1 == cells.back() ? getGCellId(*edge.gcell2) : cell1);
+        edges.push_back(nextEdge);
+        prevEdge = nextEdge;
+    }
+    if (edges.size() != routeSize || cells.back() != getGCellId(net.gCellTwo)) return false;
+
+    // the edges from lo to hi are ripped up
+    size_t lo = edges.size(), hi = 0;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const Edge &edge = grEdgeArr[edges[i]];
+        if (edge.usage > edge.capacity) {
+            lo = min(lo, i);
+            hi = i;
+        }
+    }
+    if (lo > hi) return false;
+    lo = lo > partialRipSlack ? lo - partialRipSlack : 0;
+    hi = min(hi + partialRipSlack, edges.size() - 1);
+    if (2 * (hi - lo + 1) > edges.size()) return false;
+
+    const vector<IdType> ripped(&edges[lo], &edges[hi] + 1);
+    for (IdType edgeId : ripped) { ripUpSegment(net, edgeId); }
+
+    const Point from = gcellIdtoCoord(cells[lo]), to = gcellIdtoCoord(cells[hi + 1]);
+    auto lower = [](CoordType a, CoordType b) {
+        return min(a, b) > partialRipMargin ? min(a, b) - partialRipMargin : 0;
+    };
+    const Point botleft(lower(from.x, to.x), lower(from.y, to.y), 0);
+    const Point topright(min(max(from.x, to.x) + partialRipMargin, gcellArrSzX - 1),
+        min(max(from.y, to.y) + partialRipMargin, gcellArrSzY - 1), 0);
+    vector<Edge *> path;
+    const bool allowOverflow = false;
+    routeMaze(from, to, allowOverflow, botleft, topright, func, path);
+
+    // the new section may touch the kept parts of the route at the cut points only
+    vector<IdType> kept(cells.data(), cells.data() + lo);
+    kept.insert(kept.end(), cells.data() + hi + 2, cells.data() + cells.size());
+    sort(kept.begin(), kept.end());
+    bool clear = !path.empty();
+    for (size_t i = 0; i < path.size() && clear; ++i) {
+        clear = !binary_search(kept.begin(), kept.end(), getGCellId(*path[i]->gcell1))
+                && !binary_search(kept.begin(), kept.end(), getGCellId(*path[i]->gcell2));
+    }
+
+    if (!clear) {
+        for (IdType edgeId : ripped) { addSegment(net, grEdgeArr[edgeId]); }
+        return false;
+    }
+    addPath(net, path);
+    return true;
+}
+
+//@brief: check whether a route is as short as the net allows: the pins are
+//        connected with the Manhattan distance and the fewest vias that reach
+//        the wiring layers it needs. Such a route cannot improve under unit cost.
+bool SimpleGR::hasShortestRoute(const Net &net) const
+{
+    // buildGrid puts horizontal wires on layer 0 and vertical ones on layer 1
+    const CoordType horizLayer = 0, vertLayer = 1;
+    const Point &one = net.gCellOne;
+    const Point &two = net.gCellTwo;
+    const CoordType dx = max(one.x, two.x) - min(one.x, two.x);
+    const CoordType dy = max(one.y, two.y) - min(one.y, two.y);
+
+    // the route goes from one.z to two.z through all layers in [lo, hi]
+    CoordType lo = min(one.z, two.z), hi = max(one.z, two.z);
+    if (dx > 0) {
+        lo = min(lo, horizLayer);
+        hi = max(hi, horizLayer);
+    }
+    if (dy > 0) {
+        lo = min(lo, vertLayer);
+        hi = max(hi, vertLayer);
+    }
+    const CoordType minVias = (hi - lo) + min((one.z - lo) + (hi - two.z), (hi - one.z) + (two.z - lo));
+
+    return static_cast<CostType>(net.numSegments) + viaFactor * static_cast<CostType>(net.numVias)
+           <= static_cast<CostType>(dx + dy) + viaFactor * static_cast<CostType>(minVias);
+}
+
 //@brief: rips up a routed net, frees the routing resources it uses, and marks it unrouted.
 void SimpleGR::ripUpNet(const IdType netId)
 {
     Net &net = grNetArr[netId];
-    for (unsigned i = 0; i < net.segments.size(); ++i) { ripUpSegment(netId, net.segments[i]); }
-    net.segments.clear();
+    for (const RouteRun &run : net.runs) {
+        for (IdType i = 0; i < run.length; ++i) { releaseEdge(net, grEdgeArr[edgeOfRowMajorId(run.first + i)]); }
+    }
+    net.runs.clear();
     net.routed = false;
 }
 
-//@brief: Process nets in a bulk mode: Collect unrouted nets, sort them, and route them
-void SimpleGR::routeNets(bool allowOverflow, const EdgeCost &func)
+//@brief: Process nets in a bulk mode: Collect unrouted nets in the given order and route them
+void SimpleGR::routeNets(const vector<IdType> &order, bool allowOverflow, const EdgeCost &func)
 {
     vector<IdType> netIdVec;
-    for (unsigned i = 0; i < grNetArr.size(); ++i) {
+    for (IdType i : order) {
         if (!grNetArr[i].routed) { netIdVec.push_back(i); }
     }
 
-    sort(netIdVec.begin(), netIdVec.end(), CompareByBox(&grNetArr));
-
     bool bboxConstrain = true;
 
     SimpleProgRpt report(netIdVec.size());
-    unsigned routedNets = 0;
+    unsigned routedNets = 0, patternNets = 0;
     for (unsigned i = 0; i < netIdVec.size(); ++i) {
         Net &net = grNetArr[netIdVec[i]];
         report.update(i);
 
         if (net.routed) continue;
 
-        routeNet(net, allowOverflow, bboxConstrain, func);
+        if (!outOfTime()) { routeNet(net, allowOverflow, bboxConstrain, func); }
+        // the search may have been cut short by the deadline as well
+        if (!net.routed && outOfTime()) {
+            routeNetPattern(net);
+            ++patternNets;
+        }
         if (net.routed) { routedNets++; }
     }
     cout << "routed " << routedNets << " GR nets" << endl;
+    if (patternNets > 0) { cout << "out of time, " << patternNets << " GR nets routed on L shapes" << endl; }
 }
 
 
@@ -161,16 +487,28 @@ void SimpleGR::routeNets(bool allowOverflow, const EdgeCost &func)
 void SimpleGR::doRRR(void)
 {
     if (params.maxRipIter == 0) return;
+    if (stage >= StageRRR) {
+        cout << "Rip-up and re-route already done, skipping" << endl;
+        return;
+    }
 
     vector<IdType> netsToRip;
-    unsigned iterations = 1;
-    EdgeCost &dlm = EdgeCost::getFunc(this);
-    dlm.setType(EdgeCost::DLMCost);
+    vector<uint8_t> ripNet(grNetArr.size());
+    const EdgeCost dlm(this, EdgeCost::DLMCost);
 
     cout << "[Iterative Rip-up and Re-Route starts]" << endl;
     cout << "Performing at most " << params.maxRipIter << " rip-up and re-route iteration(s)" << endl;
 
-    double startCPU = cpuTime();
+    setStageDeadline(rrrBudgetShare, params.timeOut);
+    vector<RouteRun> oldRoute;
+    RRRController control(totalOverflow, params.stallIter);
+    cheapestRoutes = params.astar;
+
+    // the routes with the lowest overflow so far, which a timeout falls back to,
+    // and the RRR iteration that left them, 0 for the routes RRR starts from
+    RouteSnapshot best;
+    saveRoutes(best);
+    unsigned bestIteration = rrrIteration - 1;
 
     const bool bboxConstrain = true;
     const bool nobboxConstrain = false;
@@ -178,27 +516,27 @@ void SimpleGR::doRRR(void)
     const bool donotallowOverflow = false;
 
     // outer RRR loop, each loop is one RRR iteration
-    while (true) {
+    for (unsigned iteration = 0; !outOfTime(); ++iteration) {
         // Start collecting unrouted nets
-        for (unsigned i = 0; i < grNetArr.size(); ++i) {
-            if (!grNetArr[i].routed) { netsToRip.push_back(i); }
-        }
+        for (unsigned i = 0; i < grNetArr.size(); ++i) { ripNet[i] = !grNetArr[i].routed; }
         // figure out which edges have overflow
         // and update their history costs
         for (unsigned i = 0; i < grEdgeArr.size(); ++i) {
             if (grEdgeArr[i].usage > grEdgeArr[i].capacity) {
-                netsToRip.insert(netsToRip.end(), grEdgeArr[i].nets.begin(), grEdgeArr[i].nets.end());
+                // after an ECO, only the overflow around the changes is worked on
+                const GCell &gcell = *grEdgeArr[i].gcell1;
+                if (!inEcoRegion(gcell.x, gcell.y, gcell.x, gcell.y)) continue;
+                for (IdType netId : grEdgeArr[i].nets) { ripNet[netId] = true; }
                 // overflow edge's history cost increments in each iteration.
                 // The history cost is used by the DLM EdgeCost functor
                 // to heavily penalize edges that repeatedly overflow
-                grEdgeArr[i].historyCost += historyIncrement;
+                grEdgeArr[i].historyCost += control.historyIncrement;
             }
         }
-        // get rid of the duplicated nets in the queue
-        sort(netsToRip.begin(), netsToRip.end());
-        netsToRip.erase(unique(netsToRip.begin(), netsToRip.end()), netsToRip.end());
-        // sort the queue by the size of the nets
-        sort(netsToRip.begin(), netsToRip.end(), CompareByBox(&grNetArr));
+        // queue the marked nets, smaller bounding boxes first
+        for (IdType netId : netOrder) {
+            if (ripNet[netId]) { netsToRip.push_back(netId); }
+        }
         // Done collecting unrouted nets
 
         if (netsToRip.size() == 0) {
@@ -206,58 +544,113 @@ void SimpleGR::doRRR(void)
             break;
         }
         cout << endl;
-        cout << "RRR Iteration " << iterations << " starts" << endl;
+        cout << "RRR Iteration " << rrrIteration << " starts" << endl;
         cout << "number of GR nets that need to be ripped up: " << netsToRip.size() << endl;
 
         // inner RRR loop, each loop rips up and reroutes a net.
         SimpleProgRpt report(netsToRip.size());
+        unsigned partialNets = 0;
         for (unsigned i = 0; i < netsToRip.size(); ++i) {
             report.update(i);
 
             const IdType netId = netsToRip[i];
             Net &net = grNetArr[netId];
 
-            // rip up the net
-            ripUpNet(netId);
-
-            // re-route the net
-            if (totalOverflow <= 500) {
-                // try to route without allowing overflow
-                routeNet(net, donotallowOverflow, nobboxConstrain, dlm);
-                if (!net.routed) {
-                    // failing that, allow overflow
-                    routeNet(net, allowOverflow, nobboxConstrain, dlm);
-                }
+            if (rerouteAroundOverflow(net, dlm)) {
+                // a long route, only the part around its overflow was rerouted
+                ++partialNets;
             } else {
-                routeNet(net, allowOverflow, bboxConstrain, dlm);
+                // rip up the net, keeping its route in case the deadline interrupts the reroute
+                oldRoute.assign(net.runs.begin(), net.runs.end());
+                ripUpNet(netId);
+
+                // re-route the net
+                if (control.fullGrid(totalOverflow)) {
+                    // try to route without allowing overflow
+                    routeNet(net, donotallowOverflow, nobboxConstrain, dlm);
+                    if (!net.routed) {
+                        // failing that, allow overflow
+                        routeNet(net, allowOverflow, nobboxConstrain, dlm);
+                    }
+                } else {
+                    routeNet(net, allowOverflow, bboxConstrain, dlm, control.boxMargin());
+                }
             }
 
+            if (outOfTime()) {
+                if (!net.routed) { restoreRoute(net, oldRoute); }
+                break;
+            }
             // End as soon as possible
             if (overfullEdges == 0) break;
         }
 
+        const size_t numRipped = netsToRip.size();
         netsToRip.clear();
-        cout << "RRR iteration " << iterations << " ends" << endl;
-        ++iterations;
+        if (partialNets > 0) { cout << "rerouted " << partialNets << " GR nets around their overflow only" << endl; }
+        cout << "RRR iteration " << rrrIteration << " ends" << endl;
+        ++rrrIteration;
 
         printStatisticsLight();
-        double cpuTimeUsed = cpuTime();
+        saveSnapshot("iter" + to_string(rrrIteration - 1));
+        if (totalOverflow < best.totalOverflow) {
+            saveRoutes(best);
+            bestIteration = rrrIteration - 1;
+        }
+
+        if (params.checkpointInterval > 0 && (rrrIteration - 1) % params.checkpointInterval == 0) {
+            saveCheckpoint();
+        }
 
-        if (iterations >= params.maxRipIter) {
+        const unsigned effort = control.effort;
+        const CostType increment = control.historyIncrement;
+        if (!control.update(totalOverflow, numRipped)) {
+            cout << "No progress in " << params.stallIter << " iterations, quitting" << endl;
+            break;
+        }
+        if (control.effort != effort) {
+            if (control.fullGrid(numeric_limits<unsigned>::max())) {
+                cout << "rerouting on the whole grid from now on" << endl;
+            } else {
+                cout << "rerouting in bounding boxes grown by " << control.boxMargin() << " gcells from now on" << endl;
+            }
+        }
+        if (control.historyIncrement != increment) {
+            cout << "history increment set to " << control.historyIncrement << endl;
+        }
+
+        if (rrrIteration >= params.maxRipIter) {
             cout << "Iterations exceeded, quitting" << endl;
             break;
         }
-        if (cpuTimeUsed > startCPU + params.timeOut) {
+        if (outOfTime()) {
             cout << "Timeout exceeded, quitting" << endl;
             break;
         }
     }
+    if (outOfTime() && totalOverflow > best.totalOverflow) {
+        restoreRoutes(best);
+        if (bestIteration == 0) {
+            cout << "restored the routes before RRR, total overflow " << totalOverflow << endl;
+        } else {
+            cout << "restored the routes of RRR iteration " << bestIteration << ", total overflow " << totalOverflow
+                 << endl;
+        }
+    }
     cout << "[Iterative Rip-up and Re-Route ends]" << endl;
+    cheapestRoutes = false;
+
+    stage = StageRRR;
+    saveCheckpoint();
 }
 
 //@brief: Route all nets one by one in a wire length greedy mode.
 void SimpleGR::greedyImprovement(void)
 {
+    if (stage >= StageGreedy) {
+        cout << "Greedy improvement already done, skipping" << endl;
+        return;
+    }
     if (totalOverflow > 0) {
         cout << "Warning: skipping greedy improvement due to overflowing solution" << endl;
         return;
@@ -266,34 +659,144 @@ void SimpleGR::greedyImprovement(void)
     cout << "[Greedy improvement routing starts]" << endl;
 
     // Since we want to get greedy with wire length, we use the unit cost function
-    EdgeCost &uc = EdgeCost::getFunc(this);
-    uc.setType(EdgeCost::UnitCost);
+    const EdgeCost uc(this, EdgeCost::UnitCost);
 
     const bool donotallowOverflow = false;
     const bool noBBoxConstrain = false;
 
-    vector<IdType> netArray;
-    for (unsigned i = 0; i < grNetArr.size(); ++i) { netArray.push_back(i); }
-    sort(netArray.begin(), netArray.end(), CompareByBox(&grNetArr));
+    // after an ECO, only the nets around the changes are improved
+    vector<IdType> ecoNets;
+    if (!ecoRegionSum.empty()) {
+        for (IdType netId : netOrder) {
+            const Net &net = grNetArr[netId];
+            if (inEcoRegion(min(net.gCellOne.x, net.gCellTwo.x), min(net.gCellOne.y, net.gCellTwo.y),
+                    max(net.gCellOne.x, net.gCellTwo.x), max(net.gCellOne.y, net.gCellTwo.y))) {
+                ecoNets.push_back(netId);
+            }
+        }
+    }
+    const vector<IdType> &netArray = ecoRegionSum.empty() ? netOrder : ecoNets;
 
     cout << "performing " << params.maxGreedyIter << " greedy improvement iteration(s)" << endl;
 
-    for (unsigned iterations = 1; iterations <= params.maxGreedyIter; ++iterations) {
-        cout << endl << "examining " << netArray.size() << " GR nets " << endl;
-        SimpleProgRpt report(netArray.size());
-        for (unsigned i = 0; i < netArray.size(); ++i) {
-            report.update(i);
-            Net &net = grNetArr[netArray[i]];
-            // Rip-up only this one net
-            ripUpNet(netArray[i]);
-            // We now know there is at least one path that the net can be routed without overflow,
-            // so we can safely turn on overflow constraint for the router.
-            routeNet(net, donotallowOverflow, noBBoxConstrain, uc);
+    setStageDeadline(1.);
+    vector<RouteRun> oldRoute;
+
+    // one search queue per worker, the first worker is this thread and uses priorityQueue
+    const size_t queueBytes = static_cast<size_t>(numLayers) * gcellArrSzX * gcellArrSzY * PQueue::bytesPerGCell();
+    const unsigned numWorkers = static_cast<unsigned>(min<size_t>(
+        { max(1U, params.numThreads), maxGreedyWorkers, 1 + greedyQueueBudget / max<size_t>(queueBytes, 1) }));
+    vector<PQueue> queues(numWorkers - 1);
+    for (PQueue &queue : queues) { queue.resize(numLayers * gcellArrSzX * gcellArrSzY); }
+    vector<uint64_t> expansions(numWorkers, 0);
+    vector<vector<Edge *>> paths(greedyBatchSize);
+    vector<IdType> nets;
+
+    // search a batch against the current routes, worker t takes every numWorkers-th net
+    size_t first = 0, batchSize = 0;
+    auto search = [&](unsigned t) {
+        PQueue &queue = (t == 0) ? priorityQueue : queues[t - 1];
+        for (size_t k = t; k < batchSize; k += numWorkers) {
+            paths[k].clear();
+            routeMazeReplacing(grNetArr[nets[first + k]], uc, queue, expansions[t], paths[k]);
         }
+    };
+    // the other workers start once and wait for each batch
+    mutex lock;
+    condition_variable changed;
+    unsigned batch = 0, searching = 0;
+    bool finished = false;
+    vector<thread> workers;
+    for (unsigned t = 1; t < numWorkers; ++t) {
+        workers.emplace_back([&, t]() {
+            for (unsigned seen = 0;; ++seen) {
+                {
+                    unique_lock<mutex> guard(lock);
+                    changed.wait(guard, [&]() { return finished || batch != seen; });
+                    if (finished) return;
+                }
+                search(t);
+                lock_guard<mutex> guard(lock);
+                if (--searching == 0) { changed.notify_all(); }
+            }
+        });
+    }
+
+    for (unsigned iterations = 1; iterations <= params.maxGreedyIter && !outOfTime(); ++iterations) {
+        nets.clear();
+        for (IdType netId : netArray) {
+            if (!hasShortestRoute(grNetArr[netId])) { nets.push_back(netId); }
+        }
+        cout << endl << "examining " << nets.size() << " GR nets, " << netArray.size() - nets.size()
+             << " already have a shortest route" << endl;
+
+        SimpleProgRpt report(nets.size());
+        unsigned improvedNets = 0, conflictNets = 0;
+        for (first = 0; first < nets.size() && !outOfTime(); first += greedyBatchSize) {
+            batchSize = min(greedyBatchSize, nets.size() - first);
+            {
+                lock_guard<mutex> guard(lock);
+                ++batch;
+                searching = numWorkers - 1;
+            }
+            changed.notify_all();
+            search(0);
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&]() { return searching == 0; });
+            }
+
+            // commit the shorter routes in order, checking that the nets before them
+            // left room for them
+            for (size_t k = 0; k < batchSize; ++k) {
+                report.update(static_cast<unsigned>(first + k));
+                Net &net = grNetArr[nets[first + k]];
+                const CostType oldCost = unitRouteCost(net, uc);
+                CostType newCost = 0.;
+                for (const Edge *edge : paths[k]) { newCost += edge->type == VIA ? uc.viaCost() : uc.Unit(); }
+                if (paths[k].empty() || newCost >= oldCost) continue;
+
+                oldRoute.assign(net.runs.begin(), net.runs.end());
+                ripUpNet(net.id);
+                bool fits = true;
+                for (const Edge *edge : paths[k]) {
+                    const CapType demand = edge->type == VIA ? 0 : minWidths[edge->layer] + minSpacings[edge->layer];
+                    fits = fits && edge->usage + demand <= edge->capacity;
+                }
+                if (fits) {
+                    addPath(net, paths[k]);
+                    net.routed = true;
+                } else {
+                    // The old route still fits, it was committed while the nets before
+                    // it were, so there is at least one path without overflow. The
+                    // search need not find the shortest one, the old route stays if
+                    // it is shorter, so that a cut short greedy stage never ends on
+                    // longer routes than it started from.
+                    ++conflictNets;
+                    routeNet(net, donotallowOverflow, noBBoxConstrain, uc);
+                    if (net.routed && unitRouteCost(net, uc) > oldCost) { ripUpNet(net.id); }
+                    if (!net.routed) { restoreRoute(net, oldRoute); }
+                }
+                if (unitRouteCost(net, uc) < oldCost) { ++improvedNets; }
+            }
+        }
+        if (outOfTime()) { cout << "Time budget exceeded, quitting" << endl; }
+        cout << "shortened " << improvedNets << " GR nets, " << conflictNets << " rerouted again after a conflict"
+             << endl;
         cout << "after greedy improvement iteration " << iterations << endl;
         printStatisticsLight();
     }
+    {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+    }
+    changed.notify_all();
+    for (thread &worker : workers) { worker.join(); }
+    for (uint64_t count : expansions) { mazeExpansions += count; }
     cout << "[Greedy improvement routing ends]" << endl;
+
+    stage = StageGreedy;
+    saveCheckpoint();
 }
 
 //@brief: Initial route all nets with minimum effort.
@@ -301,19 +804,88 @@ void SimpleGR::initialRouting(void)
 {
     cout << "[Initial routing starts]" << endl;
 
+    setStageDeadline(initialBudgetShare);
+
     // We want the initial route to be congestion aware, hence
     // use the DLMCost function.
-    EdgeCost &dlm = EdgeCost::getFunc(this);
-    dlm.setType(EdgeCost::DLMCost);
+    const EdgeCost dlm(this, EdgeCost::DLMCost);
+
+    // smaller bounding boxes first, or the order of the congestion estimate
+    const vector<IdType> order = params.rudy ? estimateCongestion() : netOrder;
 
     cout << "phase 1. routing flat GR nets" << endl;
     const bool donotallowOverflow = false;
-    routeFlatNets(donotallowOverflow, dlm);
+    routeFlatNets(order, donotallowOverflow, dlm);
     cout << "CPU time: " << cpuTime() << " seconds " << endl;
 
     cout << "phase 2. routing remaining GR nets" << endl;
     const bool allowOverflow = true;
-    routeNets(allowOverflow, dlm);
+    routeNets(order, allowOverflow, dlm);
 
     cout << "[Initial routing ends]" << endl;
+
+    stage = StageInitial;
+    saveCheckpoint();
+    saveSnapshot("init");
+}
+
+//@brief: load the routes of params.warmFile in place of initial routing. Nets the
+//        file does not route are routed here the way initial routing would.
+void SimpleGR::warmStart(void)
+{
+    cout << "[Warm start from a solution]" << endl;
+    parseSolution(params.warmFile.c_str());
+    // an open or otherwise broken route counts as missing
+    const size_t brokenNets = ripUpBrokenRoutes().size();
+
+    unsigned loadedNets = 0;
+    for (const Net &net : grNetArr) { loadedNets += net.routed; }
+    cout << "loaded routes of " << loadedNets << " GR nets, ripped up " << brokenNets << " broken route(s)" << endl;
+
+    if (loadedNets < routableNets) {
+        setStageDeadline(initialBudgetShare);
+        const bool allowOverflow = true;
+        routeNets(netOrder, allowOverflow, EdgeCost(this, EdgeCost::DLMCost));
+    }
+
+    stage = StageInitial;
+    saveCheckpoint();
+    saveSnapshot("init");
+}
+
+//@brief: the complete flow on the design given by the parameters: read it,
+//        perform 3-stage global routing, and save the solution
+void SimpleGR::run(void)
+{
+    // read in the nets and create the grid input file
+    parseInput();
+    printParams();
+
+    if (!params.ecoDeltaFile.empty()) {
+        // start from the previous solution, only the nets the ECO changes are unrouted
+        loadEco();
+    } else if (!params.warmFile.empty()) {
+        // start from a solution, it takes the place of initial routing
+        warmStart();
+        printStatistics();
+    } else {
+        // continue from a checkpoint if asked to
+        loadCheckpoint();
+    }
+    buildCoarseGrid();
+
+    // perform 3-stage global routing
+    if (getStage() < StageInitial) {
+        initialRouting();
+        printStatistics();
+    }
+
+    doRRR();
+    printStatistics();
+
+    greedyImprovement();
+    printStatistics(true, true);
+
+    // output solution file
+    writeRoutes();
 }
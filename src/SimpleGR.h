@@ -3,15 +3,21 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include <limits>
-#include <map>
+#include <memory>
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "NameIndex.h"
+#include "Snapshot.h"
+#include "Tokenizer.h"
+
 using CoordType = uint32_t;
 using IdType = uint32_t;
 using LenType = uint32_t;
@@ -68,6 +74,136 @@ inline bool operator<(const Point &a, const Point &b)
     return a.x < b.x || (a.x == b.x && a.y < b.y) || (a.x == b.x && a.y == b.y && a.z < b.z);
 }
 
+//@brief: memory of the route storage, the runs of a net and the nets of an
+//        edge. Routes grow and shrink a few runs at a time over rip-up and
+//        re-route, which makes for many small allocations of a few sizes. The
+//        pool rounds them up to powers of 2 and keeps a free list per size, so
+//        freed blocks are reused without going through malloc. Blocks are carved
+//        from large chunks, which are released with the pool only. Not thread
+//        safe: routes are changed by one thread at a time.
+class RoutePool
+{
+  public:
+    RoutePool() : allocations(0), systemAllocations(0), cur(NULL), end(NULL)
+    {
+        fill(freeLists, freeLists + numClasses, static_cast<Block *>(NULL));
+    }
+    RoutePool(const RoutePool &) = delete;
+    RoutePool &operator=(const RoutePool &) = delete;
+
+    void *allocate(size_t bytes)
+    {
+        ++allocations;
+        const unsigned c = sizeClass(bytes);
+        if (c >= numClasses) {
+            ++systemAllocations;
+            return ::operator new(bytes);
+        }
+        Block *block = freeLists[c];
+        if (block == NULL) return carve(c);
+        freeLists[c] = block->next;
+        return block;
+    }
+    void deallocate(void *p, size_t bytes)
+    {
+        const unsigned c = sizeClass(bytes);
+        if (c >= numClasses) {
+            ::operator delete(p);
+            return;
+        }
+        Block *block = static_cast<Block *>(p);
+        block->next = freeLists[c];
+        freeLists[c] = block;
+    }
+
+    uint64_t allocations;// requests served so far
+    uint64_t systemAllocations;// the ones that went to operator new, chunks included
+
+  private:
+    struct Block
+    {
+        Block *next;
+    };
+    // blocks of 8 << c bytes for size class c, larger requests go to operator new
+    static const unsigned numClasses = 10;
+    static const size_t chunkSize = 1 << 16;
+
+    static unsigned sizeClass(size_t bytes)
+    {
+        return bytes <= 8 ? 0 : static_cast<unsigned>(64 - __builtin_clzll(bytes - 1)) - 3;
+    }
+    void *carve(unsigned c);
+
+    Block *freeLists[numClasses];
+    vector<unique_ptr<char[]>> chunks;
+    char *cur, *end;// the unused part of the last chunk
+};
+
+//@brief: allocator of the route storage from a RoutePool, or from operator new
+//        when default constructed. It moves with the containers, so copies of
+//        nets and edges stay in the pool of the originals.
+template <class T>
+class RouteAllocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = true_type;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    RouteAllocator() noexcept : pool(NULL) {}
+    explicit RouteAllocator(RoutePool *p) noexcept : pool(p) {}
+    template <class U>
+    RouteAllocator(const RouteAllocator<U> &other) noexcept : pool(other.pool)
+    {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(pool != NULL ? pool->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n)
+    {
+        if (pool != NULL) {
+            pool->deallocate(p, n * sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    RoutePool *pool;
+};
+
+template <class T, class U>
+bool operator==(const RouteAllocator<T> &a, const RouteAllocator<U> &b)
+{
+    return a.pool == b.pool;
+}
+template <class T, class U>
+bool operator!=(const RouteAllocator<T> &a, const RouteAllocator<U> &b)
+{
+    return a.pool != b.pool;
+}
+
+using IdList = vector<IdType, RouteAllocator<IdType>>;
+
+//@brief: a straight piece of a route, the edges whose row-major ids (see
+//        SimpleGR::rowMajorEdgeId) are first, ..., first + length - 1. They are
+//        of one type and follow each other along a row or a column.
+struct RouteRun
+{
+    IdType first, length;
+};
+
+using RunList = vector<RouteRun, RouteAllocator<RouteRun>>;
+
+//@brief: a copy of the routes of all nets, see SimpleGR::saveRoutes
+struct RouteSnapshot
+{
+    vector<IdType> firstRun;// the runs of net i are runs[firstRun[i]], ..., runs[firstRun[i + 1] - 1]
+    vector<RouteRun> runs;
+    unsigned totalOverflow;
+};
+
 class Net
 {
   public:
@@ -75,15 +211,24 @@ class Net
     Point gCellOne, gCellTwo;
     IdType id;
     bool routed;
-    vector<IdType> segments;
+    // the route, sorted by RouteRun::first. Runs that touch end to end are merged.
+    RunList runs;
 
     Net() : numSegments(0), numVias(0), gCellOne(0, 0, 0), gCellTwo(0, 0, 0), id(NULLID), routed(false) {}
+    explicit Net(const RouteAllocator<IdType> &alloc)
+        : numSegments(0), numVias(0), gCellOne(0, 0, 0), gCellTwo(0, 0, 0), id(NULLID), routed(false), runs(alloc)
+    {}
     Net(const Net &orig)
         : numSegments(orig.numSegments), numVias(orig.numVias), gCellOne(orig.gCellOne), gCellTwo(orig.gCellTwo),
-          id(orig.id), routed(orig.routed), segments(orig.segments)
+          id(orig.id), routed(orig.routed), runs(orig.runs)
     {}
 };
 
+// bits of GCell::blockedDirs, one per direction. The bit of a dec direction is
+// the bit of the inc direction along the same axis shifted left by one.
+enum DirBit : uint8_t { INCX_BIT = 1, DECX_BIT = 2, INCY_BIT = 4, DECY_BIT = 8, INCZ_BIT = 16, DECZ_BIT = 32 };
+const uint8_t ALL_DIR_BITS = 63;
+
 //@brief: GCell class is derived from Point to include coordinate on a grid
 //        It also contains the Id of edges connected to this gcell
 class GCell : public Point
@@ -91,13 +236,19 @@ class GCell : public Point
   public:
     // Edge Id in all 6 directions (3D grid)
     IdType incX, decX, incY, decY, incZ, decZ;
+    // directions without an edge, or whose edge has no room left for another
+    // wire, see SimpleGR::updateBlockedDirs
+    uint8_t blockedDirs;
 
     // Default constructor. The default gcell has no connection in all
     // 6 directions (NULLID)
-    GCell() : Point(), incX(NULLID), decX(NULLID), incY(NULLID), decY(NULLID), incZ(NULLID), decZ(NULLID) {}
+    GCell()
+        : Point(), incX(NULLID), decX(NULLID), incY(NULLID), decY(NULLID), incZ(NULLID), decZ(NULLID),
+          blockedDirs(ALL_DIR_BITS)
+    {}
     GCell(const GCell &orig)
         : Point(orig), incX(orig.incX), decX(orig.decX), incY(orig.incY), decY(orig.decY), incZ(orig.incZ),
-          decZ(orig.decZ)
+          decZ(orig.decZ), blockedDirs(orig.blockedDirs)
     {}
 };
 
@@ -117,7 +268,7 @@ class Edge
     uint32_t layer : 8;
     uint32_t id;
     // nets that routes pass this edge
-    vector<IdType> nets;
+    IdList nets;
     // used by DLM cost function
     CostType historyCost;
 
@@ -141,63 +292,24 @@ class PQueue
         CostType totalCost;// aggregated edge cost(pathCost) + Manhattan distance cost of this gcell
         CostType pathCost;// aggregated edge cost along the path
         IdType parentGCell;// the gcell that this gcell propagated from. This is used for the back-trace process
+        uint32_t stamp;// the gcell is visited if this equals PQueue::visitStamp
     };
 
-
-    ///////////////////////////////////////////////////////////////////////////////
-    // BitBoard is used inside the Priority Queue to keep track of visited gcells
-    ///////////////////////////////////////////////////////////////////////////////
-    class BitBoard
-    {
-      private:
-        vector<IdType> setBits;
-        vector<bool> bits;
-
-      public:
-        BitBoard() : setBits(0), bits(0) {}
-        BitBoard(IdType size) : setBits(0), bits(size, false) {}
-        const vector<IdType> &getSetBits(void) { return setBits; }
-        void setBit(IdType id)
-        {
-            if (!bits.at(id)) {
-                bits[id] = true;
-                setBits.push_back(id);
-            }
-        }
-
-        bool isBitSet(IdType id) const { return bits.at(id); }
-
-        void clear(void)
-        {
-            for (unsigned i = 0; i < setBits.size(); ++i) { bits[setBits[i]] = false; }
-            setBits.clear();
-        }
-
-        void resize(IdType size)
-        {
-            IdType oldSize = static_cast<IdType>(bits.size());
-
-            clear();
-            bits.resize(size);
-            if (oldSize < size) {
-                for (IdType i = oldSize; i < size; ++i) { bits[i] = false; }
-            }
-        }
-    };
-
+    // the gcells visited by a search are the ones whose stamp equals visitStamp,
+    // so clearing the queue only needs a new stamp
     vector<GCellData> data;
-    BitBoard dataValid;
+    uint32_t visitStamp;
     vector<IdType> heap;
 
   public:
-    PQueue() : data(), dataValid(), heap() {};
-
-    // allocate the pqueue data size, typically it's the same as the total num of gcells
-    void resize(unsigned newSize)
-    {
-        data.resize(newSize);
-        dataValid.resize(newSize);
-    }
+    PQueue() : data(), visitStamp(1), heap() {};
+
+    // allocate the pqueue data size, the most gcells a search may visit. Searches
+    // index it by their own numbering of the gcells, see SearchWindow in MazeRouter.cpp
+    void resize(unsigned newSize) { data.resize(newSize); }
+    size_t capacity(void) const { return data.size(); }
+    // the bytes a resize takes per gcell
+    static constexpr size_t bytesPerGCell(void) { return sizeof(GCellData); }
     // check if nothing left in heap
     bool isEmpty() const { return heap.empty(); }
     // Reset the priority queue to an empty state
@@ -214,6 +326,31 @@ class PQueue
     const GCellData &getGCellData(IdType gcellId) const;
     // Returns if a gcell has been visited previously
     bool isGCellVsted(IdType gcellId) const;
+    // Returns if a gcell has been visited and not removed from the queue yet
+    bool isGCellQueued(IdType gcellId) const;
+};
+
+//@brief: the grid coarsened into tiles of factor x factor gcells, see Corridor.cpp.
+//        Tile (x, y) has index y * sizeX + x.
+class CoarseGrid
+{
+  public:
+    CoordType factor;// 0 when there is no coarse grid
+    IdType sizeX, sizeY;
+    // the boundary between a tile and its right (horiz) or upper (vert) neighbor,
+    // summed over the fine edges crossing it
+    vector<uint32_t> horizCap, horizUsage, vertCap, vertUsage;
+    // A* search over the tiles, a tile's entries are valid if visited holds visitStamp
+    vector<CostType> dist;
+    vector<IdType> parent;
+    vector<uint32_t> visited;
+    uint32_t visitStamp;
+    vector<IdType> path;// tiles of the last coarse route, target first
+    vector<uint32_t> corridor;// tiles of the current corridor hold corridorStamp
+    uint32_t corridorStamp;
+    Point corridorLow, corridorHigh;// corners of the gcells the current corridor spans, z is unused
+
+    CoarseGrid() : factor(0), sizeX(0), sizeY(0), visitStamp(0), corridorStamp(0) {}
 };
 
 //@brief: manages commandline parameters passed to the SimpleGR
@@ -228,10 +365,26 @@ class SimpleGRParams
   public:
     bool layerAssign;
     bool verbose;
+    bool useCache;
+    bool rudy;// seed history costs and the initial routing order from a congestion estimate
+    bool astar;// RRR searches find the cheapest routes, see ManhattanHeuristic in MazeRouter.cpp
     unsigned maxRipIter, maxGreedyIter;
-    double timeOut;
+    unsigned stallIter;// RRR ends after this many iterations without progress, 0 never ends it early
+    unsigned coarsen;// gcells per side of the tiles long nets are routed over first, 0 for no coarse routing
+    unsigned tileSize;// gcells per side of the tiles gcells and edges are numbered in, 0 for row by row
+    unsigned numThreads;
+    unsigned checkpointInterval;// RRR iterations between checkpoints, 0 saves only at stage boundaries
+    unsigned snapshotSize;// maximum width and height of congestion snapshots, in pixels
+    double timeOut;// wall-clock seconds
+    double budget;// wall-clock seconds for the whole flow, 0 for no limit
     string outputFile;
     string inputFile;
+    string checkpointFile;
+    string resumeFile;
+    string snapshotPrefix;
+    string warmFile;// solution to start from instead of initial routing
+    string ecoSolutionFile;// previous solution to apply ecoDeltaFile to
+    string ecoDeltaFile;
 
     SimpleGRParams(void) { setDefault(); }
     SimpleGRParams(int argc, char **argv);
@@ -246,6 +399,10 @@ class SimpleGR
 {
     friend class EdgeCost;
 
+  public:
+    // the last completed routing stage
+    enum RouteStage { StageNone, StageInitial, StageRRR, StageGreedy };
+
   private:
     // design stats
     IdType gcellArrSzX, gcellArrSzY, numLayers, routableNets, nonViaEdges;
@@ -253,51 +410,124 @@ class SimpleGR
 
     // routing stats
     unsigned totalOverflow, overfullEdges, totalSegments, totalVias;
+    uint64_t mazeExpansions;// gcells taken off the queue by all maze searches
+
+    // routing progress, saved in checkpoints
+    RouteStage stage;
+    unsigned rrrIteration;// the next RRR iteration to run
+
+    // wall-clock time budget. Routing loops and long maze searches stop once the
+    // deadline of the current stage has passed, see setStageDeadline
+    using Clock = chrono::steady_clock;
+    Clock::time_point flowStart, stageDeadline;
+
+    // storage of the routes, see RoutePool. Declared first, it outlives them
+    RoutePool routePool;
+    RouteAllocator<IdType> routeAlloc(void) { return RouteAllocator<IdType>(&routePool); }
 
     // global routing data
     vector<CapType> vertCaps, horizCaps, minWidths, minSpacings, viaSpacings;
     vector<Net> grNetArr;
-    vector<string> netNameArr;
+    NameArena netNameArr;
+    NameArena unroutableNetNameArr;// nets with both pins in the same gcell
     vector<IdType> netDBIdArr;
-    vector<vector<vector<GCell>>> gcellArr3D;
+    vector<IdType> netOrder;// all nets, smallest bounding box first, see buildNetOrder
+    bool cheapestRoutes;// the DLM searches of RRR run as A* searches, see params.astar
+    CoarseGrid coarse;
+    vector<uint32_t> ecoRegionSum;// prefix sums over the gcells an ECO changed, empty without an ECO
+    // all gcells by id, see gcellCoordToId. With tiles, ids in partial tiles at
+    // the grid border are unused and hold default gcells.
+    vector<GCell> gcellArr;
+    CoordType tileShift;// gcells are numbered in tiles of 2^tileShift x 2^tileShift, 0 for row by row
+    IdType tilesX;// tiles per row of the grid
+    vector<IdType> edgeByRowMajorId;// see edgeOfRowMajorId, empty without tiles
     vector<Edge> grEdgeArr;
     PQueue priorityQueue;
-    map<string, Net *> netNameToPtrMap;
+    // Net lookup by name, built on demand by buildNetNameIndex. Routable nets map to
+    // their id, unroutable ones to unroutableNetFlag | their index in unroutableNetNameArr
+    static const uint32_t unroutableNetFlag = 0x80000000U;
+    NameIndex netNameIndex;
+    MappedFile designCache;// backs netNameArr when the design is loaded from its cache
+    SnapshotWriter snapshotWriter;
 
     SimpleGRParams params;
 
+    //@brief: the id of gcell (x, y, z). Gcells are numbered row by row and
+    //        layer by layer, or, with params.tileSize, tile by tile, the layers
+    //        of a tile after one another and each row by row
     inline IdType gcellCoordToId(const CoordType x, const CoordType y, const CoordType z) const
     {
         assert(x < gcellArrSzX);
         assert(y < gcellArrSzY);
         assert(z < numLayers);
-        return z * gcellArrSzY * gcellArrSzX + y * gcellArrSzX + x;
+        if (tileShift == 0) return z * gcellArrSzY * gcellArrSzX + y * gcellArrSzX + x;
+        const CoordType mask = (1U << tileShift) - 1;
+        const IdType tile = (y >> tileShift) * tilesX + (x >> tileShift);
+        return ((((tile * numLayers + z) << tileShift) | (y & mask)) << tileShift) | (x & mask);
     }
     inline Point gcellIdtoCoord(const IdType id) const
     {
-        assert(id < numLayers * gcellArrSzX * gcellArrSzY);
-        return Point(id % gcellArrSzX, (id / gcellArrSzX) % gcellArrSzY, id / (gcellArrSzX * gcellArrSzY));
+        assert(id < gcellArr.size());
+        return Point(gcellArr[id]);
     }
 
     //@brief: get the reference of a gcell from an gcell ID
-    GCell &getGCell(const IdType gcellId)
-    {
-        Point gcell = gcellIdtoCoord(gcellId);
-        return gcellArr3D[gcell.z][gcell.y][gcell.x];
-    }
+    GCell &getGCell(const IdType gcellId) { return gcellArr[gcellId]; }
+    GCell &gcellAt(CoordType x, CoordType y, CoordType z) { return gcellArr[gcellCoordToId(x, y, z)]; }
+    const GCell &gcellAt(CoordType x, CoordType y, CoordType z) const { return gcellArr[gcellCoordToId(x, y, z)]; }
+    //@brief: the number of gcell ids, unused ones included
+    IdType numGCellIds(void) const { return static_cast<IdType>(gcellArr.size()); }
 
     //@brief: get the gcell's ID from a gcell
     IdType getGCellId(const Point gcell) { return gcellCoordToId(gcell.x, gcell.y, gcell.z); }
-
+    IdType rowMajorEdgeId(const Edge &edge) const;
+    //@brief: the edge with row-major id `id', see rowMajorEdgeId
+    IdType edgeOfRowMajorId(IdType id) const { return tileShift == 0 ? id : edgeByRowMajorId[id]; }
+
+    void loadDesign(const string &filename, bool removeBlockedEdges);
+    void parseDesign(const string &filename, bool removeBlockedEdges);
+    void applyCapacityAdjustments(Tokenizer &tok, bool removeBlockedEdges);
+    void loadDesignCache(const string &cacheFile, bool removeBlockedEdges);
+    void writeDesignCache(const string &cacheFile, const string &designFile) const;
+    void buildNetNameIndex(void);
+    uint32_t findNetName(string_view name) const;
+    void formatRoutes(IdType first, IdType last, string &buf) const;
     void buildGrid(void);
+    void buildNetOrder(void);
+    void initBlockedDirs(void);
+    void updateBlockedDirs(const Edge &edge);
 
     void addSegment(Net &net, Edge &edge);
-    void ripUpSegment(const IdType netId, IdType edgeId);
+    void addPath(Net &net, const vector<Edge *> &path);
+    void addRun(Net &net, RouteRun run);
+    void useEdge(Net &net, Edge &edge);
+    void releaseEdge(Net &net, Edge &edge);
+    void ripUpSegment(Net &net, IdType edgeId);
     void ripUpNet(const IdType netId);
-
-    void routeFlatNets(bool allowOverflow, const EdgeCost &func);
-    CostType routeNet(Net &net, bool allowOverflow, bool bboxConstrain, const EdgeCost &f);
-    void routeNets(bool allowOverflow, const EdgeCost &func);
+    void routeEdges(const Net &net, vector<IdType> &edges) const;
+    struct RouteCheck;// see Verify.cpp
+    void checkRoutes(vector<RouteCheck> &checks) const;
+    vector<IdType> ripUpBrokenRoutes(void);
+
+    void buildCoarseGrid(void);
+    IdType coarseBoundary(const Edge &edge) const;
+    void updateCoarseUsage(const Edge &edge, int demand);
+    bool markCorridor(const Net &net, CoordType widen);
+    vector<IdType> estimateCongestion(void);
+    void buildEcoRegion(const vector<pair<Point, Point>> &boxes);
+    bool inEcoRegion(CoordType x0, CoordType y0, CoordType x1, CoordType y1) const;
+
+    void setStageDeadline(double budgetShare, double stageLimit = 0.);
+    bool outOfTime(void) const { return Clock::now() >= stageDeadline; }
+    void restoreRoute(Net &net, const vector<RouteRun> &route);
+    void saveRoutes(RouteSnapshot &snapshot) const;
+    void restoreRoutes(const RouteSnapshot &snapshot);
+    void routeNetPattern(Net &net);
+    bool appendStraightPath(const Point &from, const Point &to, vector<IdType> &edges) const;
+
+    void routeFlatNets(const vector<IdType> &order, bool allowOverflow, const EdgeCost &func);
+    CostType routeNet(Net &net, bool allowOverflow, bool bboxConstrain, const EdgeCost &f, CoordType boxMargin = 0);
+    void routeNets(const vector<IdType> &order, bool allowOverflow, const EdgeCost &func);
 
     CostType routeMaze(Net &net,
         bool allowOverflow,
@@ -305,6 +535,38 @@ class SimpleGR
         const Point &topright,
         const EdgeCost &func,
         vector<Edge *> &path);
+    CostType routeMaze(const Point &source,
+        const Point &dest,
+        bool allowOverflow,
+        const Point &botleft,
+        const Point &topright,
+        const EdgeCost &func,
+        vector<Edge *> &path);
+    CostType routeMazeWide(Net &net, bool allowOverflow, const EdgeCost &func, vector<Edge *> &path);
+    template <class BBoxPolicy>
+    CostType routeMazeIn(const Point &source,
+        const Point &dest,
+        bool allowOverflow,
+        const BBoxPolicy &bbox,
+        const EdgeCost &func,
+        vector<Edge *> &path);
+    CostType routeMazeReplacing(const Net &net,
+        const EdgeCost &func,
+        PQueue &queue,
+        uint64_t &expansions,
+        vector<Edge *> &path);
+    template <class CostPolicy, class OverflowPolicy, class BBoxPolicy, class Heuristic>
+    CostType routeMaze(const Point &source,
+        const Point &dest,
+        const CostPolicy &cost,
+        const OverflowPolicy &overflow,
+        const BBoxPolicy &bbox,
+        const Heuristic &heuristic,
+        PQueue &queue,
+        uint64_t &expansions,
+        vector<Edge *> &path);
+    bool rerouteAroundOverflow(Net &net, const EdgeCost &func);
+    bool hasShortestRoute(const Net &net) const;
 
     // Additional function declarations
     // Function to check if a GCell is within the bounding box
@@ -319,17 +581,28 @@ class SimpleGR
     SimpleGR(const SimpleGRParams &_params = SimpleGRParams())
         : gcellArrSzX(0), gcellArrSzY(0), numLayers(0), routableNets(0), nonViaEdges(0), minX(0), minY(0),
           gcellWidth(0), gcellHeight(0), halfWidth(0), halfHeight(0), totalOverflow(0), overfullEdges(0),
-          totalSegments(0), totalVias(0), params(_params)
+          totalSegments(0), totalVias(0), mazeExpansions(0), stage(StageNone), rrrIteration(1), flowStart(Clock::now()),
+          stageDeadline(Clock::time_point::max()), cheapestRoutes(false), tileShift(0), tilesX(0), params(_params)
     {}
 
+    void run(void);
     void parseInput();
     void parseInputMapper(const char *filename);
     void parseSolution(const char *filename);
+    bool verifyRoutes(void) const;
     void writeRoutes(void);
     void initialRouting(void);
+    void warmStart(void);
     void doRRR(void);
     void greedyImprovement(void);
 
+    void saveCheckpoint(void);
+    bool loadCheckpoint(void);
+    void loadEco(void);
+    RouteStage getStage(void) const { return stage; }
+
+    void saveSnapshot(const string &tag);
+
     void printParams(void) { params.print(); }
     void printStatistics(bool checkRouted = true, bool final = false);
     void printStatisticsLight(void);
@@ -337,32 +610,16 @@ class SimpleGR
     void plotXPM(const string &filename);
 };
 
-//@brief: Functor class defined to compare nets by their bounding boxes
-class CompareByBox
-{
-    const vector<Net> *p_nets_;
-
-  public:
-    CompareByBox(const vector<Net> *p_nets) : p_nets_(p_nets) {}
-
-    bool operator()(const IdType a, const IdType b) const;
-};
-
 //@brief: Edge cost function class. It will be extensively used by the MazeRouter.
-//@note:  This class is a Singleton -- it is instantiated only once, but can be
-//        referenced globally. It is also a Functor that computes the cost of
-//        an edge.
+//@note:  This is a Functor that computes the cost of an edge of the router it
+//        was created for. Routing stages create their own, so routers in one
+//        process do not share any state.
 class EdgeCost
 {
   public:
     // Two types of cost functions are defined here
     enum EdgeCostType { UnitCost, DLMCost };
-    // Use this API to get a reference of this cost function
-    static EdgeCost &getFunc(const SimpleGR *p_gr)
-    {
-        static EdgeCost costf(p_gr);
-        return costf;
-    }
+    EdgeCost(const SimpleGR *p_gr, EdgeCostType type) : p_gr_(p_gr), type_(type) {}
     // Functor API. Returns cost of the edge
     inline CostType operator()(IdType edgeId) const
     {
@@ -377,16 +634,9 @@ class EdgeCost
     }
     // This API sets the cost function type for the proper circumstance
     void setType(EdgeCostType type) { type_ = type; }
+    EdgeCostType getType(void) const { return type_; }
 
-  private:
-    const SimpleGR *p_gr_;
-    EdgeCostType type_;
-    EdgeCost(const SimpleGR *p_gr) : p_gr_(p_gr), type_(DLMCost)
-    {// Not Implemented
-    }
-    EdgeCost(EdgeCost const &);// Not Implemented
-    void operator=(EdgeCost const &);// Not Implemented
-
+    // The cost functions by themselves, the maze router picks one at compile time
     inline CostType viaCost(void) const
     {
         return viaFactor * edgeBase;// 3x as costly as a "regular" segment
@@ -409,21 +659,18 @@ class EdgeCost
             return edgeBase + edge.historyCost * uRatio;
         }
     }
+
+  private:
+    const SimpleGR *p_gr_;
+    EdgeCostType type_;
 };
 
 //@brief: Computes the Manhattan distance between two gcells. This cost function can
 //        be used as the 'heuristic cost' for A* star search
-//@note:  This class is a Singleton -- it is instantiated only once, but can be
-//        referenced globally. It is also a Functor.
+//@note:  This class is a Functor without state.
 class ManhattanCost
 {
   public:
-    // Use this API to acquire an reference of this class
-    static ManhattanCost &getFunc()
-    {
-        static ManhattanCost em;
-        return em;
-    }
     // Functor API, returns Manhattan distance
     // Inserted from nick's project, handles types correctly unlike the original version
     inline CostType operator()(const Point a, const Point b) const
@@ -434,12 +681,6 @@ class ManhattanCost
 
         return edgeBase * (x_cost + y_cost + z_cost);
     }
-
-  private:
-    ManhattanCost()// Not Implemented
-    {}
-    ManhattanCost(ManhattanCost const &);// Not Implemented
-    void operator=(ManhattanCost const &);// Not Implemented
 };
 
 //@brief: a percentage progress printing utility for simpleGR
@@ -481,6 +722,7 @@ class SimpleProgRpt
 
 //@brief: A simple CPU timer API
 double cpuTime(void);
+double peakMemory(void);
 
 
 #endif
@@ -0,0 +1,238 @@
+/*
+ * Snapshot.cpp
+ * Congestion heatmaps. Besides the averaged map plotted by the mapper, the router
+ * can save per-layer maps after every routing iteration, see saveSnapshot.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "SimpleGR.h"
+
+namespace {
+// XPM color definitions, the first character of each is the pixel character
+const char *coolMap[heatmapColors] = {
+    "a c #ffffff",
+    "b c #00009f",
+    "c c #0000af",
+    "d c #0000bf",
+    "e c #0000cf",
+    "f c #0000df",
+    "g c #0000ef",
+    "h c #0000ff",
+    "i c #000fff",
+    "j c #001fff",
+    "k c #002fff",
+    "l c #003fff",
+    "m c #004fff",
+    "n c #005fff",
+    "o c #006fff",
+    "p c #007fff",
+    "q c #008fff",
+    "r c #009fff",
+    "s c #00afff",
+    "t c #00bfff",
+    "u c #00cfff",
+    "v c #00dfff",
+    "w c #00efff",
+    "x c #00ffff",
+    "y c #0fffef",
+    "z c #1fffdf",
+    "A c #2fffcf",
+    "B c #3fffbf",
+    "C c #4fffaf",
+    "D c #5fff9f",
+    "E c #6fff8f",
+    "F c #7fff7f",
+    "G c #8fff6f",
+    "H c #9fff5f",
+    "I c #afff4f",
+    "J c #bfff3f",
+    "K c #cfff2f",
+    "L c #dfff1f",
+    "M c #efff0f",
+    "N c #ffff00",
+    "O c #ffef00",
+    "P c #ffdf00",
+    "Q c #ffcf00",
+    "R c #ffbf00",
+    "S c #ffaf00",
+    "T c #ff9f00",
+    "U c #ff8f00",
+    "V c #ff7f00",
+    "W c #ff6f00",
+    "X c #ff5f00",
+    "Y c #ff4f00",
+    "Z c #ff3f00",
+    "0 c #ff2f00",
+    "1 c #ff1f00",
+    "2 c #ff0f00",
+    "3 c #ff0000",
+    "4 c #ef0000",
+    "5 c #df0000",
+    "6 c #cf0000",
+    "7 c #bf0000",
+    "8 c #af0000",
+    "9 c #9f0000",
+    ", c #8f0000",
+    ". c #7f0000"
+};
+
+// RGB values of coolMap, for the binary PPM maps
+struct PaletteRGB
+{
+    uint8_t rgb[heatmapColors][3];
+
+    PaletteRGB()
+    {
+        for (unsigned i = 0; i < heatmapColors; ++i) {
+            const unsigned long value = strtoul(coolMap[i] + 5, NULL, 16);// skip "a c #"
+            rgb[i][0] = static_cast<uint8_t>(value >> 16);
+            rgb[i][1] = static_cast<uint8_t>(value >> 8);
+            rgb[i][2] = static_cast<uint8_t>(value);
+        }
+    }
+};
+
+// hottest color of the snapshots. They share one fixed scale, so that the maps of
+// different iterations can be compared: a full edge is green, twice full is dark red
+const double snapshotMaxRatio = 2.;
+}// namespace
+
+uint8_t heatmapColor(double ratio, double maxRatio)
+{
+    return static_cast<uint8_t>(floor(min(ratio / maxRatio, 1.) * static_cast<double>(heatmapColors - 1)));
+}
+
+bool writeHeatmapXPM(const Heatmap &map)
+{
+    ofstream xpmFile((map.filename + ".xpm").c_str());
+
+    xpmFile << "/* XPM */" << endl;
+    xpmFile << "static char *congestion[] = {" << endl;
+    xpmFile << "/* columns rows colors chars-per-pixel */" << endl;
+    xpmFile << "\"" << map.width << " " << map.height << " " << heatmapColors << " 1\"," << endl;
+    for (unsigned i = 0; i < heatmapColors; ++i) xpmFile << "\"" << coolMap[i] << "\"," << endl;
+    xpmFile << "/* pixels */" << endl;
+
+    // each row is formatted into a buffer and written at once
+    string row;
+    for (unsigned j = 0; j < map.height; ++j) {
+        row.assign(1, '"');
+        const uint8_t *pixel = &map.pixels[static_cast<size_t>(j) * map.width];
+        for (unsigned i = 0; i < map.width; ++i) row += coolMap[pixel[i]][0];
+        row += (j + 1 == map.height) ? "\"\n" : "\",\n";
+        xpmFile.write(row.data(), static_cast<streamsize>(row.size()));
+    }
+    xpmFile << ");" << endl;
+    xpmFile.close();
+    return xpmFile.good();
+}
+
+bool writeHeatmapPPM(const Heatmap &map)
+{
+    static const PaletteRGB palette;
+
+    ofstream ppmFile((map.filename + ".ppm").c_str(), ios::binary);
+    ppmFile << "P6\n" << map.width << " " << map.height << "\n255\n";
+
+    vector<uint8_t> row(3 * static_cast<size_t>(map.width));
+    for (unsigned j = 0; j < map.height; ++j) {
+        const uint8_t *pixel = &map.pixels[static_cast<size_t>(j) * map.width];
+        for (unsigned i = 0; i < map.width; ++i) copy(palette.rgb[pixel[i]], palette.rgb[pixel[i]] + 3, &row[3 * i]);
+        ppmFile.write(reinterpret_cast<const char *>(row.data()), static_cast<streamsize>(row.size()));
+    }
+    ppmFile.close();
+    return ppmFile.good();
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void SnapshotWriter::push(Heatmap &&map)
+{
+    unique_lock<mutex> lock(mutex_);
+    if (!worker_.joinable()) worker_ = thread(&SnapshotWriter::run, this);
+    done_.wait(lock, [this]() { return pending_.size() < maxPending; });
+    pending_.push_back(move(map));
+    wake_.notify_one();
+}
+
+void SnapshotWriter::flush(void)
+{
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_.empty() && !busy_; });
+}
+
+void SnapshotWriter::run(void)
+{
+    unique_lock<mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) return;// stopping, and nothing left to write
+
+        Heatmap map = move(pending_.front());
+        pending_.pop_front();
+        busy_ = true;
+        done_.notify_all();
+        lock.unlock();
+
+        if (!writeHeatmapXPM(map) || !writeHeatmapPPM(map)) {
+            cout << ("Warning: could not write congestion snapshot `" + map.filename + "'\n") << std::flush;
+        }
+
+        lock.lock();
+        busy_ = false;
+        done_.notify_all();
+    }
+}
+
+//@brief: queue per-layer congestion heatmaps of the current routing state for
+//        writing, as <snapshotPrefix>.<tag>.layer<z>.{xpm,ppm}. Pixel (x, y) shows
+//        the usage/capacity ratio of the gcell's wire edge on that layer. Grids
+//        larger than params.snapshotSize are downsampled, every pixel showing the
+//        worst ratio of the gcells it covers so that hot spots stay visible.
+void SimpleGR::saveSnapshot(const string &tag)
+{
+    if (params.snapshotPrefix.empty()) return;
+
+    const unsigned maxSize = max(1U, params.snapshotSize);
+    const unsigned factor = (max(gcellArrSzX, gcellArrSzY) + maxSize - 1) / maxSize;
+    const unsigned width = (gcellArrSzX + factor - 1) / factor;
+    const unsigned height = (gcellArrSzY + factor - 1) / factor;
+
+    vector<float> ratios;
+    for (unsigned z = 0; z < numLayers; ++z) {
+        ratios.assign(static_cast<size_t>(width) * height, 0.f);
+        for (unsigned y = 0; y < gcellArrSzY; ++y) {
+            float *row = &ratios[static_cast<size_t>(height - 1 - y / factor) * width];
+            for (unsigned x = 0; x < gcellArrSzX; ++x) {
+                const GCell &gcell = gcellAt(x, y, z);
+                for (IdType edgeId : { gcell.incX, gcell.incY }) {
+                    if (edgeId == NULLID) continue;
+                    const Edge &edge = grEdgeArr[edgeId];
+                    // edges blocked to zero capacity count as if they had a single track
+                    const float ratio = static_cast<float>(edge.usage) / static_cast<float>(max(edge.capacity, 1U));
+                    row[x / factor] = max(row[x / factor], ratio);
+                }
+            }
+        }
+
+        Heatmap map(params.snapshotPrefix + "." + tag + ".layer" + to_string(z + 1), width, height);
+        for (size_t i = 0; i < ratios.size(); ++i) map.pixels[i] = heatmapColor(ratios[i], snapshotMaxRatio);
+        snapshotWriter.push(move(map));
+    }
+    cout << "Congestion snapshot `" << params.snapshotPrefix << "." << tag << ".layer*'";
+    if (factor > 1) cout << ", downsampled " << factor << "x";
+    cout << endl;
+}
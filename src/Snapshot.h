@@ -0,0 +1,68 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// number of colors of the heatmap palette, from white (empty) over blue and green to dark red
+const unsigned heatmapColors = 64;
+
+//@brief: a congestion heatmap, one palette index per pixel, rows top to bottom
+struct Heatmap
+{
+    std::string filename;// without extension
+    unsigned width, height;
+    std::vector<uint8_t> pixels;
+
+    Heatmap() : width(0), height(0) {}
+    Heatmap(const std::string &name, unsigned w, unsigned h)
+        : filename(name), width(w), height(h), pixels(static_cast<size_t>(w) * h, 0)
+    {}
+};
+
+// palette index of a usage/capacity ratio on a scale where maxRatio is the hottest color
+uint8_t heatmapColor(double ratio, double maxRatio);
+
+// write `map' as <filename>.xpm, returns false on an I/O error
+bool writeHeatmapXPM(const Heatmap &map);
+// write `map' as binary <filename>.ppm with the same palette, returns false on an I/O error
+bool writeHeatmapPPM(const Heatmap &map);
+
+//@brief: writes heatmaps (XPM and PPM) on a background thread, so that taking a
+//        snapshot costs the router only the time to fill in the pixels. The thread
+//        is started on the first push and joined when the writer is destroyed,
+//        after everything pushed has been written.
+class SnapshotWriter
+{
+  public:
+    SnapshotWriter() : stopping_(false), busy_(false) {}
+    ~SnapshotWriter();
+
+    // queue `map' for writing. Blocks only while maxPending maps are still waiting.
+    void push(Heatmap &&map);
+    // wait until every queued map is written
+    void flush(void);
+
+  private:
+    static const size_t maxPending = 16;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;// signals the worker
+    std::condition_variable done_;// signals producers waiting in push or flush
+    std::deque<Heatmap> pending_;
+    bool stopping_;
+    bool busy_;
+
+    void run(void);
+
+    SnapshotWriter(SnapshotWriter const &);// Not Implemented
+    void operator=(SnapshotWriter const &);// Not Implemented
+};
+
+#endif
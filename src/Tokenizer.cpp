@@ -0,0 +1,70 @@
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Tokenizer.h"
+
+using namespace std;
+
+bool MappedFile::open(const string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+        // mmap refuses empty files, hand out an empty buffer instead
+        static const char empty[1] = { 0 };
+        data_ = empty;
+        mapped_ = false;
+        ::close(fd);
+        return true;
+    }
+
+    void *addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    // designs are read front to back, let the kernel read ahead aggressively
+    madvise(addr, size_, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char *>(addr);
+    mapped_ = true;
+    return true;
+}
+
+void MappedFile::close(void)
+{
+    if (mapped_) { munmap(const_cast<char *>(data_), size_); }
+    data_ = NULL;
+    size_ = 0;
+    mapped_ = false;
+}
+
+void Tokenizer::error(const char *where, const string &msg) const
+{
+    // line and column are only needed here, so they are computed lazily
+    unsigned line = 1, column = 1;
+    for (const char *p = origin_; p < where; ++p) {
+        if (*p == '\n') {
+            ++line;
+            column = 1;
+        } else {
+            ++column;
+        }
+    }
+    throw InputError("Parsing error in `" + filename_ + "' at line " + to_string(line) + ", column "
+                     + to_string(column) + ". " + msg);
+}
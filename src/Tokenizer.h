@@ -0,0 +1,173 @@
+#ifndef _TOKENIZER_H_
+#define _TOKENIZER_H_
+
+#include <charconv>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+//@brief: thrown on input the router cannot use: a file that cannot be read, a
+//        parse error, a checkpoint of another design. what() is the message for
+//        the user. The router that threw it cannot be used any more.
+class InputError : public std::runtime_error
+{
+  public:
+    explicit InputError(const std::string &msg) : std::runtime_error(msg) {}
+};
+
+//@brief: keeps the exception thrown by the threads reading parts of a file, so
+//        that it can be thrown again on the thread that joins them. Of several,
+//        the one of the earliest part is kept, the one a sequential read would
+//        have hit first.
+class PartErrors
+{
+  public:
+    PartErrors() : part_(0) {}
+
+    template <class F>
+    void run(std::size_t part, F &&body) noexcept
+    {
+        try {
+            body();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_ || part < part_) {
+                error_ = std::current_exception();
+                part_ = part;
+            }
+        }
+    }
+    void rethrow(void) const
+    {
+        if (error_) std::rethrow_exception(error_);
+    }
+
+  private:
+    std::mutex mutex_;
+    std::exception_ptr error_;
+    std::size_t part_;
+};
+
+//@brief: read-only memory mapping of a whole file. The mapping is released
+//        when the object goes out of scope.
+class MappedFile
+{
+  public:
+    MappedFile() : data_(NULL), size_(0), mapped_(false) {}
+    explicit MappedFile(const std::string &filename) : data_(NULL), size_(0), mapped_(false) { open(filename); }
+    ~MappedFile() { close(); }
+
+    // map `filename' into memory, returns false if the file cannot be read
+    bool open(const std::string &filename);
+    void close(void);
+
+    bool isOpen(void) const { return data_ != NULL; }
+    const char *begin(void) const { return data_; }
+    const char *end(void) const { return data_ + size_; }
+    std::size_t size(void) const { return size_; }
+
+  private:
+    const char *data_;
+    std::size_t size_;
+    bool mapped_;// false for empty files, which cannot be mapped
+
+    MappedFile(MappedFile const &);// Not Implemented
+    void operator=(MappedFile const &);// Not Implemented
+};
+
+//@brief: a whitespace separated tokenizer working directly on a character buffer
+//        (typically a MappedFile). Numbers are parsed with std::from_chars, which
+//        is locale independent and does not allocate.
+//@note:  Parsing errors throw an InputError with the file, line and column of
+//        the offending token.
+class Tokenizer
+{
+  public:
+    // [begin, end) is the range to tokenize, origin is the beginning of the whole
+    // file and is only used to compute line/column numbers for error messages
+    Tokenizer(const char *begin, const char *end, const char *origin, const std::string &filename)
+        : cur_(begin), end_(end), origin_(origin), filename_(filename)
+    {}
+
+    // returns true if only whitespace is left in the range
+    bool atEnd(void)
+    {
+        skipSpace();
+        return cur_ == end_;
+    }
+    // current position in the buffer
+    const char *pos(void) const { return cur_; }
+
+    // returns the next whitespace separated word, empty at the end of the range
+    std::string_view nextWord(void)
+    {
+        skipSpace();
+        const char *start = cur_;
+        while (cur_ != end_ && !isSpace(*cur_)) ++cur_;
+        return std::string_view(start, static_cast<std::size_t>(cur_ - start));
+    }
+
+    // returns the first character of the next word without consuming it, 0 at the end of the range
+    char peek(void)
+    {
+        skipSpace();
+        return cur_ == end_ ? '\0' : *cur_;
+    }
+    // returns the rest of the current line, without the line break
+    std::string_view readLine(void)
+    {
+        const char *start = cur_;
+        while (cur_ != end_ && *cur_ != '\n') ++cur_;
+        return std::string_view(start, static_cast<std::size_t>(cur_ - start));
+    }
+
+    // reads the next word and fails if it differs from `word'
+    void expect(std::string_view word)
+    {
+        skipSpace();
+        const char *start = cur_;
+        std::string_view got = nextWord();
+        if (got != word) {
+            error(start, "Expected `" + std::string(word) + "' but got `" + std::string(got) + "' instead");
+        }
+    }
+
+    // reads an unsigned integer
+    unsigned readUInt(void) { return readNumber<unsigned>("an unsigned integer"); }
+    // reads a floating point number
+    double readDouble(void) { return readNumber<double>("a number"); }
+
+    // prints `msg' along with the line and column of `where' and exits
+    [[noreturn]] void error(const char *where, const std::string &msg) const;
+
+  private:
+    const char *cur_;
+    const char *end_;
+    const char *origin_;
+    const std::string &filename_;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+    void skipSpace(void)
+    {
+        while (cur_ != end_ && isSpace(*cur_)) ++cur_;
+    }
+
+    template<typename T>
+    T readNumber(const char *what)
+    {
+        skipSpace();
+        T value = T();
+        std::from_chars_result res = std::from_chars(cur_, end_, value);
+        if (res.ec != std::errc() || (res.ptr != end_ && !isSpace(*res.ptr))) {
+            const char *start = cur_;
+            error(start, std::string("Expected ") + what + " but got `" + std::string(nextWord()) + "' instead");
+        }
+        cur_ = res.ptr;
+        return value;
+    }
+};
+
+#endif
@@ -1,8 +1,10 @@
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <sys/resource.h>
+#include <thread>
 #include <vector>
 
 #include "SimpleGR.h"
@@ -16,6 +18,30 @@ double cpuTime(void)
            + static_cast<double>(cputime.ru_stime.tv_sec) + (1.e-6) * static_cast<double>(cputime.ru_stime.tv_usec);
 }
 
+//@brief: a new block of size class `c', from the last chunk or a new one
+void *RoutePool::carve(unsigned c)
+{
+    const size_t bytes = size_t(8) << c;
+    if (static_cast<size_t>(end - cur) < bytes) {
+        ++systemAllocations;
+        chunks.emplace_back(new char[chunkSize]);
+        cur = chunks.back().get();
+        end = cur + chunkSize;
+    }
+    void *block = cur;
+    cur += bytes;
+    return block;
+}
+
+// peak resident set size of the process, in megabytes
+double peakMemory(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // Linux reports it in kilobytes
+    return static_cast<double>(usage.ru_maxrss) / 1024.;
+}
+
 void SimpleGR::printStatistics(bool checkRouted, bool final)
 {
     cout << endl << "GR Stats :" << endl;
@@ -45,6 +71,12 @@ void SimpleGR::printStatistics(bool checkRouted, bool final)
     cout << stringFinal << "max overflow is " << maxOverfill << endl;
     cout << stringFinal << "total overflow is " << totalOverflow << endl;
     cout << stringFinal << "avg overflow is " << totalOverflow / static_cast<double>(nonViaEdges) << endl;
+    if (mazeExpansions > 0) { cout << stringFinal << "maze expansions " << mazeExpansions << endl; }
+    if (final) {
+        cout << stringFinal << "route allocations " << routePool.allocations << ", " << routePool.systemAllocations
+             << " from the system allocator" << endl;
+        cout << stringFinal << "peak memory: " << peakMemory() << " MB" << endl;
+    }
     cout << stringFinal << "CPU time: " << cpuTime() << " seconds" << endl << endl << flush;
 }
 
@@ -73,84 +105,193 @@ void SimpleGR::buildGrid(void)
     assert(horizCaps[0]);
     assert(vertCaps[1]);
 
-    // Allocate a 3D matrix for the gcell grid
+    // Allocate the gcells, numbered as gcellCoordToId says
     // Note: all gcells created this way are constructed by their default constructor
-    gcellArr3D.resize(numLayers);
-    for (unsigned k = 0; k < numLayers; ++k) {
-        gcellArr3D[k].resize(gcellArrSzY);
-        for (unsigned j = 0; j < gcellArrSzY; ++j) { gcellArr3D[k][j].resize(gcellArrSzX); }
+    tileShift = 0;
+    while (params.tileSize >= 2U << tileShift) ++tileShift;
+    const IdType tileSide = 1U << tileShift;
+    tilesX = (gcellArrSzX + tileSide - 1) >> tileShift;
+    const IdType tilesY = (gcellArrSzY + tileSide - 1) >> tileShift;
+    gcellArr.resize(static_cast<size_t>(tilesX) * tilesY * tileSide * tileSide * numLayers);
+    for (CoordType k = 0; k < numLayers; ++k) {
+        for (CoordType j = 0; j < gcellArrSzY; ++j) {
+            for (CoordType i = 0; i < gcellArrSzX; ++i) { gcellAt(i, j, k).setCoord(i, j, k); }
+        }
     }
 
     Edge newEdge;
     newEdge.usage = 0;
+    newEdge.nets = IdList(routeAlloc());
 
     // Roughly estimate upper bound of edge vector size and allocate it
     //  Note: all edges created this way are constructed by their default constructor
     grEdgeArr.reserve(gcellArrSzX * gcellArrSzY * (numLayers + 1));
 
-    // add horizontal edges on the first layer
-    for (CoordType j = 0; j < gcellArrSzY; ++j) {
-        for (CoordType i = 0; i < gcellArrSzX - 1; ++i) {
-            // fill up edge data
-            IdType edgeId = static_cast<IdType>(grEdgeArr.size());
-            newEdge.gcell1 = &gcellArr3D[0][j][i];
-            newEdge.gcell2 = &gcellArr3D[0][j][i + 1];
-            newEdge.capacity = horizCaps[0];
-            newEdge.type = HORIZ;
-            newEdge.layer = 0;
-            newEdge.id = edgeId;
-            // fill up gcell data
-            newEdge.gcell1->incX = edgeId;
-            newEdge.gcell2->decX = edgeId;
-            newEdge.gcell1->setCoord(i, j, 0);
-            if (i == gcellArrSzX - 2) {// last gcell on the row
-                newEdge.gcell2->setCoord(i + 1, j, 0);
-            }
-            // save edge
-            grEdgeArr.push_back(newEdge);
+    // horizontal edges on the first layer
+    auto addHoriz = [&](CoordType i, CoordType j) {
+        // fill up edge data
+        IdType edgeId = static_cast<IdType>(grEdgeArr.size());
+        newEdge.gcell1 = &gcellAt(i, j, 0);
+        newEdge.gcell2 = &gcellAt(i + 1, j, 0);
+        newEdge.capacity = horizCaps[0];
+        newEdge.type = HORIZ;
+        newEdge.layer = 0;
+        newEdge.id = edgeId;
+        // fill up gcell data
+        newEdge.gcell1->incX = edgeId;
+        newEdge.gcell2->decX = edgeId;
+        // save edge
+        grEdgeArr.push_back(newEdge);
+    };
+    // vertical edges on the second layer
+    auto addVert = [&](CoordType i, CoordType j) {
+        IdType edgeId = static_cast<IdType>(grEdgeArr.size());
+        newEdge.gcell1 = &gcellAt(i, j, 1);
+        newEdge.gcell2 = &gcellAt(i, j + 1, 1);
+        newEdge.capacity = vertCaps[1];
+        newEdge.type = VERT;
+        newEdge.layer = 1;
+        newEdge.id = edgeId;
+        newEdge.gcell1->incY = edgeId;
+        newEdge.gcell2->decY = edgeId;
+        grEdgeArr.push_back(newEdge);
+    };
+    auto addVia = [&](CoordType i, CoordType j) {
+        IdType edgeId = static_cast<IdType>(grEdgeArr.size());
+        newEdge.gcell1 = &gcellAt(i, j, 0);
+        newEdge.gcell2 = &gcellAt(i, j, 1);
+        newEdge.capacity = 255U;// via capacity is not considered
+        newEdge.type = VIA;
+        newEdge.id = edgeId;
+        newEdge.gcell1->incZ = edgeId;
+        newEdge.gcell2->decZ = edgeId;
+        grEdgeArr.push_back(newEdge);
+    };
+
+    nonViaEdges = (gcellArrSzX - 1) * gcellArrSzY + gcellArrSzX * (gcellArrSzY - 1);
+
+    if (tileShift > 0) {
+        // the edges of a gcell follow each other, in the order of the gcells,
+        // so that the edges of a tile are as close together as its gcells
+        for (const GCell &gcell : gcellArr) {
+            const CoordType i = gcell.x, j = gcell.y;
+            if (&gcell != &gcellAt(i, j, gcell.z)) continue;// an unused id
+            if (gcell.z == 0 && i + 1 < gcellArrSzX) addHoriz(i, j);
+            if (gcell.z == 1 && j + 1 < gcellArrSzY) addVert(i, j);
+            if (gcell.z == 0) addVia(i, j);
         }
+        edgeByRowMajorId.resize(grEdgeArr.size());
+        for (const Edge &edge : grEdgeArr) { edgeByRowMajorId[rowMajorEdgeId(edge)] = edge.id; }
+        return;
     }
 
-    // add vertical edge on the second layer
+    // all horizontal edges row by row, then the vertical ones and the vias column
+    // by column. Edges of a straight run have consecutive ids, see formatRoutes.
+    for (CoordType j = 0; j < gcellArrSzY; ++j) {
+        for (CoordType i = 0; i < gcellArrSzX - 1; ++i) { addHoriz(i, j); }
+    }
     for (CoordType i = 0; i < gcellArrSzX; ++i) {
-        for (CoordType j = 0; j < gcellArrSzY - 1; ++j) {
-            // fill up edge data
-            IdType edgeId = static_cast<IdType>(grEdgeArr.size());
-            newEdge.gcell1 = &gcellArr3D[1][j][i];
-            newEdge.gcell2 = &gcellArr3D[1][j + 1][i];
-            newEdge.capacity = vertCaps[1];
-            newEdge.type = VERT;
-            newEdge.layer = 1;
-            newEdge.id = edgeId;
-            // fill up gcell data
-            newEdge.gcell1->incY = edgeId;
-            newEdge.gcell2->decY = edgeId;
-            newEdge.gcell1->setCoord(i, j, 1);
-            if (j == gcellArrSzY - 2) {// last gcell on the column
-                newEdge.gcell2->setCoord(i, j + 1, 1);
-            }
-            // save edge
-            grEdgeArr.push_back(newEdge);
-        }
+        for (CoordType j = 0; j < gcellArrSzY - 1; ++j) { addVert(i, j); }
     }
+    for (CoordType i = 0; i < gcellArrSzX; ++i) {
+        for (CoordType j = 0; j < gcellArrSzY; ++j) { addVia(i, j); }
+    }
+    assert(grEdgeArr.back().id == rowMajorEdgeId(grEdgeArr.back()));
+}
+
+//@brief: the id `edge' has when the gcells are numbered row by row, which does not
+//        depend on params.tileSize. The design cache and checkpoints store edges
+//        by this id.
+IdType SimpleGR::rowMajorEdgeId(const Edge &edge) const
+{
+    const GCell &gcell = *edge.gcell1;
+    const IdType numHoriz = (gcellArrSzX - 1) * gcellArrSzY;
+    if (edge.type == HORIZ) return gcell.y * (gcellArrSzX - 1) + gcell.x;
+    if (edge.type == VERT) return numHoriz + gcell.x * (gcellArrSzY - 1) + gcell.y;
+    return nonViaEdges + gcell.x * gcellArrSzY + gcell.y;
+}
 
-    nonViaEdges = static_cast<IdType>(grEdgeArr.size());
-
-    // add vias
-    for (unsigned i = 0; i < gcellArrSzX; ++i) {
-        for (unsigned j = 0; j < gcellArrSzY; ++j) {
-            IdType edgeId = static_cast<IdType>(grEdgeArr.size());
-            newEdge.gcell1 = &gcellArr3D[0][j][i];
-            newEdge.gcell2 = &gcellArr3D[1][j][i];
-            newEdge.capacity = 255U;// via capacity is not considered
-            newEdge.type = VIA;
-            newEdge.id = edgeId;
-
-            newEdge.gcell1->incZ = edgeId;
-            newEdge.gcell2->decZ = edgeId;
-            grEdgeArr.push_back(newEdge);
+//@brief: set GCell::blockedDirs of all gcells from the edges, once the capacities
+//        are final. useEdge and releaseEdge keep them up to date afterwards.
+void SimpleGR::initBlockedDirs(void)
+{
+    for (GCell &gcell : gcellArr) { gcell.blockedDirs = ALL_DIR_BITS; }
+    for (const Edge &edge : grEdgeArr) { updateBlockedDirs(edge); }
+}
+
+//@brief: update the bits of `edge' in GCell::blockedDirs of its two gcells. The
+//        edge blocks the direction if it has been unlinked from the grid, or if
+//        another wire across it would overflow it.
+void SimpleGR::updateBlockedDirs(const Edge &edge)
+{
+    const CapType demand = edge.type == VIA ? 0 : minWidths[edge.layer] + minSpacings[edge.layer];
+    const bool full = edge.usage + demand > edge.capacity;
+    GCell &one = *edge.gcell1, &two = *edge.gcell2;
+    IdType linkedOne = one.incZ, linkedTwo = two.decZ;
+    uint8_t incBit = INCZ_BIT;
+    if (edge.type == HORIZ) {
+        linkedOne = one.incX;
+        linkedTwo = two.decX;
+        incBit = INCX_BIT;
+    } else if (edge.type == VERT) {
+        linkedOne = one.incY;
+        linkedTwo = two.decY;
+        incBit = INCY_BIT;
+    }
+    const uint8_t decBit = static_cast<uint8_t>(incBit << 1);
+    auto mark = [](GCell &gcell, uint8_t bit, bool blocked) {
+        gcell.blockedDirs = static_cast<uint8_t>(blocked ? gcell.blockedDirs | bit : gcell.blockedDirs & ~bit);
+    };
+    mark(one, incBit, full || linkedOne != edge.id);
+    mark(two, decBit, full || linkedTwo != edge.id);
+}
+
+namespace {
+// Sorts `ids' by `keys' (one key per id, moved along). The sort is a stable LSD
+// radix sort on bytes, so ties keep their input order. Passes in which all keys
+// share the byte are skipped, typically the high bytes of the perimeters.
+void radixSortByKey(vector<uint64_t> &keys, vector<IdType> &ids)
+{
+    vector<uint64_t> keysTmp(keys.size());
+    vector<IdType> idsTmp(ids.size());
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        size_t count[257] = { 0 };
+        for (uint64_t key : keys) ++count[((key >> shift) & 0xff) + 1];
+        if (count[((keys.empty() ? 0 : keys[0]) >> shift & 0xff) + 1] == keys.size()) continue;
+        for (unsigned i = 1; i < 257; ++i) count[i] += count[i - 1];
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const size_t pos = count[(keys[i] >> shift) & 0xff]++;
+            keysTmp[pos] = keys[i];
+            idsTmp[pos] = ids[i];
         }
+        keys.swap(keysTmp);
+        ids.swap(idsTmp);
+    }
+}
+}// namespace
+
+//@brief: order all nets by their bounding boxes, once per design. Nets with a
+//        shorter perimeter come first, then those with a smaller aspect ratio
+//        (short side / long side), then those with a smaller id. The routing
+//        stages visit nets in this order, filtering it instead of sorting.
+void SimpleGR::buildNetOrder(void)
+{
+    vector<uint64_t> keys(grNetArr.size());
+    netOrder.resize(grNetArr.size());
+    for (IdType i = 0; i < grNetArr.size(); ++i) {
+        const Net &net = grNetArr[i];
+        const Point &one = net.gCellOne, &two = net.gCellTwo;
+        const CostType width = static_cast<CostType>(max(one.x, two.x) - min(one.x, two.x));
+        const CostType height = static_cast<CostType>(max(one.y, two.y) - min(one.y, two.y));
+        // nets that only change layers have no aspect ratio
+        const CostType ratio = (width + height > 0) ? min(width, height) / max(width, height) : 0;
+        // the bits of a non-negative float order like the float itself
+        uint32_t ratioBits;
+        memcpy(&ratioBits, &ratio, sizeof(ratioBits));
+        keys[i] = (static_cast<uint64_t>(width + height) << 32) | ratioBits;
+        netOrder[i] = i;
     }
+    radixSortByKey(keys, netOrder);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -220,7 +361,7 @@ void PQueue::rmBestGCell(void)
 void PQueue::setGCellCost(IdType gcellId, CostType totalCost, CostType pathCost, IdType parent)
 {
     // printf("New gcell added %d with cost %f\n", gcellId, pathCost);
-    if (dataValid.isBitSet(gcellId)) {
+    if (data[gcellId].stamp == visitStamp) {
         if (totalCost < data[gcellId].totalCost) {
             data[gcellId].totalCost = totalCost;
             data[gcellId].pathCost = pathCost;
@@ -245,8 +386,8 @@ void PQueue::setGCellCost(IdType gcellId, CostType totalCost, CostType pathCost,
         data[gcellId].pathCost = pathCost;
         data[gcellId].parentGCell = parent;
         data[gcellId].heapLoc = static_cast<IdType>(heap.size());
+        data[gcellId].stamp = visitStamp;
         heap.push_back(gcellId);
-        dataValid.setBit(gcellId);
 
         // heap up
         IdType idx = data[gcellId].heapLoc;
@@ -267,33 +408,92 @@ void PQueue::setGCellCost(IdType gcellId, CostType totalCost, CostType pathCost,
 // Return the gcell data
 const PQueue::GCellData &PQueue::getGCellData(IdType gcellId) const
 {
-    assert(dataValid.isBitSet(gcellId));
+    assert(data[gcellId].stamp == visitStamp);
     return data[gcellId];
 }
 
 // Look up whether the gcell has been visited before
-bool PQueue::isGCellVsted(IdType gcellId) const { return dataValid.isBitSet(gcellId); }
+bool PQueue::isGCellVsted(IdType gcellId) const { return data[gcellId].stamp == visitStamp; }
+
+// Look up whether the gcell is still waiting in the queue
+bool PQueue::isGCellQueued(IdType gcellId) const
+{
+    return data[gcellId].stamp == visitStamp && data[gcellId].heapLoc != NULLID;
+}
 
-// Reset the priority queue to an empty state
+// Reset the priority queue to an empty state. The stamps are only reset when
+// the counter wraps around.
 void PQueue::clear(void)
 {
-    dataValid.clear();
+    if (++visitStamp == 0) {
+        for (GCellData &entry : data) { entry.stamp = 0; }
+        visitStamp = 1;
+    }
     heap.clear();
 }
 
 //@brief: commit the edge segment to a net's route, while updating the corresponding
 //        changes in edge usage and overflow
-void SimpleGR::addSegment(Net &net, Edge &edge)
+void SimpleGR::addSegment(Net &net, Edge &edge) { addRun(net, RouteRun{ rowMajorEdgeId(edge), 1 }); }
+
+//@brief: commit the edges of a path found by the maze search, which follow each
+//        other from one end of the path to the other
+void SimpleGR::addPath(Net &net, const vector<Edge *> &path)
+{
+    for (size_t i = 0; i < path.size();) {
+        // the straight stretch of the path from edge i, whichever way it was walked
+        IdType lo = rowMajorEdgeId(*path[i]), hi = lo;
+        size_t j = i + 1;
+        for (; j < path.size() && path[j]->type == path[i]->type; ++j) {
+            const IdType id = rowMajorEdgeId(*path[j]);
+            if (id + 1 == lo && path[j]->gcell2 == grEdgeArr[edgeOfRowMajorId(lo)].gcell1) {
+                lo = id;
+            } else if (id == hi + 1 && grEdgeArr[edgeOfRowMajorId(hi)].gcell2 == path[j]->gcell1) {
+                hi = id;
+            } else {
+                break;
+            }
+        }
+        addRun(net, RouteRun{ lo, hi - lo + 1 });
+        i = j;
+    }
+}
+
+//@brief: commit a run of edges to a net's route, merging it with the runs it
+//        touches. None of its edges may be in the route already.
+void SimpleGR::addRun(Net &net, RouteRun run)
+{
+    for (IdType i = 0; i < run.length; ++i) { useEdge(net, grEdgeArr[edgeOfRowMajorId(run.first + i)]); }
+
+    // whether run a ends where run b starts
+    auto touch = [this](const RouteRun &a, const RouteRun &b) {
+        return a.first + a.length == b.first
+               && grEdgeArr[edgeOfRowMajorId(b.first - 1)].gcell2 == grEdgeArr[edgeOfRowMajorId(b.first)].gcell1;
+    };
+    RunList &runs = net.runs;
+    RunList::iterator pos = lower_bound(runs.begin(), runs.end(), run,
+        [](const RouteRun &a, const RouteRun &b) { return a.first < b.first; });
+    assert(pos == runs.end() || pos->first >= run.first + run.length);
+    if (pos != runs.begin() && touch(*(pos - 1), run)) {
+        --pos;
+        pos->length += run.length;
+    } else {
+        pos = runs.insert(pos, run);
+    }
+    if (pos + 1 != runs.end() && touch(*pos, *(pos + 1))) {
+        pos->length += (pos + 1)->length;
+        runs.erase(pos + 1);
+    }
+}
+
+//@brief: add a net's demand to an edge, while updating the corresponding changes
+//        in edge usage and overflow
+void SimpleGR::useEdge(Net &net, Edge &edge)
 {
     IdType netId = net.id;
-    IdType edgeId = edge.id;
     const CapType curDmd = edge.type == VIA ? 0 : minWidths[edge.layer] + minSpacings[edge.layer];
 
-    vector<IdType>::iterator pos2 = lower_bound(net.segments.begin(), net.segments.end(), edgeId);
-    assert(pos2 == net.segments.end() || *pos2 != edgeId);
-    net.segments.insert(pos2, edgeId);
-
-    vector<IdType>::iterator pos3 = lower_bound(edge.nets.begin(), edge.nets.end(), netId);
+    IdList::iterator pos3 = lower_bound(edge.nets.begin(), edge.nets.end(), netId);
     assert(pos3 == edge.nets.end() || *pos3 != netId);
     edge.nets.insert(pos3, netId);
 
@@ -303,6 +503,8 @@ void SimpleGR::addSegment(Net &net, Edge &edge)
     CapType newOverflow = edge.usage > edge.capacity ? edge.usage - edge.capacity : 0;
     totalOverflow += newOverflow;
     if (oldOverflow == 0 && newOverflow > 0) { ++overfullEdges; }
+    updateBlockedDirs(edge);
+    if (coarse.factor > 0) { updateCoarseUsage(edge, static_cast<int>(curDmd)); }
     if (edge.type == VIA) {
         ++net.numVias;
         ++totalVias;
@@ -312,12 +514,11 @@ void SimpleGR::addSegment(Net &net, Edge &edge)
     }
 }
 
-//@brief: ripping the edge segment from a net's route, while updating the corresponding
+//@brief: take a net's demand off an edge, while updating the corresponding
 //        changes in edge usage and overflow
-void SimpleGR::ripUpSegment(const IdType netId, IdType edgeId)
+void SimpleGR::releaseEdge(Net &net, Edge &edge)
 {
-    Edge &edge = grEdgeArr[edgeId];
-    const CapType curDmd = grEdgeArr[edgeId].type == VIA ? 0 : minWidths[edge.layer] + minSpacings[edge.layer];
+    const CapType curDmd = edge.type == VIA ? 0 : minWidths[edge.layer] + minSpacings[edge.layer];
 
     assert(edge.usage >= curDmd);
 
@@ -327,19 +528,51 @@ void SimpleGR::ripUpSegment(const IdType netId, IdType edgeId)
     CapType newOverflow = edge.usage > edge.capacity ? edge.usage - edge.capacity : 0;
     totalOverflow += newOverflow;
     if (oldOverflow > 0 && newOverflow == 0) { --overfullEdges; }
+    updateBlockedDirs(edge);
+    if (coarse.factor > 0) { updateCoarseUsage(edge, -static_cast<int>(curDmd)); }
     if (edge.type == VIA) {
-        --grNetArr[netId].numVias;
+        --net.numVias;
         --totalVias;
     } else {
-        --grNetArr[netId].numSegments;
+        --net.numSegments;
         --totalSegments;
     }
 
-    vector<IdType>::iterator pos = lower_bound(edge.nets.begin(), edge.nets.end(), netId);
-    assert(pos != edge.nets.end() && *pos == netId);
+    IdList::iterator pos = lower_bound(edge.nets.begin(), edge.nets.end(), net.id);
+    assert(pos != edge.nets.end() && *pos == net.id);
     edge.nets.erase(pos);
 }
 
+//@brief: ripping the edge segment from a net's route, which splits the run
+//        holding it, while updating the corresponding changes in edge usage and overflow
+void SimpleGR::ripUpSegment(Net &net, IdType edgeId)
+{
+    const IdType id = rowMajorEdgeId(grEdgeArr[edgeId]);
+    RunList &runs = net.runs;
+    RunList::iterator pos = upper_bound(runs.begin(), runs.end(), id,
+                                [](IdType first, const RouteRun &run) { return first < run.first; })
+                            - 1;
+    assert(pos >= runs.begin() && id < pos->first + pos->length);
+    releaseEdge(net, grEdgeArr[edgeId]);
+
+    const RouteRun after{ id + 1, pos->first + pos->length - id - 1 };
+    pos->length = id - pos->first;
+    if (pos->length == 0) {
+        *pos = after;
+        if (after.length == 0) runs.erase(pos);
+    } else if (after.length > 0) {
+        runs.insert(pos + 1, after);
+    }
+}
+
+//@brief: append the edges of a net's route to `edges', run after run
+void SimpleGR::routeEdges(const Net &net, vector<IdType> &edges) const
+{
+    for (const RouteRun &run : net.runs) {
+        for (IdType i = 0; i < run.length; ++i) { edges.push_back(edgeOfRowMajorId(run.first + i)); }
+    }
+}
+
 void SimpleGRParams::usage(const char *exename)
 {
     cout << "Usage: " << exename << " -f <design> [options]" << endl;
@@ -348,8 +581,30 @@ void SimpleGRParams::usage(const char *exename)
     cout << "* -f <filename>         Specify design file <filename>" << endl;
     cout << "  -o <filename>         Save routes in <filename>" << endl;
     cout << "  -maxRipIter <uint>    Maximum rip-up and re-route iterations" << endl;
-    cout << "  -timeOut <double>     Rip-up and re-route timeout (seconds)" << endl;
+    cout << "  -stallIter <uint>     End rip-up and re-route after <uint> iterations without progress" << endl;
+    cout << "                        (default: 3, 0: never). Each such iteration also widens the reroute" << endl;
+    cout << "                        boxes. Use 0 to run all -maxRipIter iterations, as earlier versions did" << endl;
+    cout << "  -astar                Make rip-up and re-route searches find the cheapest routes (A*)" << endl;
+    cout << "                        instead of following the Manhattan distance, slower but less overflow" << endl;
+    cout << "  -coarsen <uint>       Route long nets over tiles of <uint> x <uint> gcells first" << endl;
+    cout << "                        (default: 0, off)" << endl;
+    cout << "  -tile <uint>          Number gcells and edges in tiles of <uint> x <uint> gcells, a power of 2" << endl;
+    cout << "                        (default: 0, row by row)" << endl;
+    cout << "  -rudy                 Estimate congestion before initial routing to seed history costs" << endl;
+    cout << "                        and the routing order" << endl;
+    cout << "  -timeOut <double>     Rip-up and re-route timeout (wall-clock seconds)" << endl;
+    cout << "  -budget <double>      Time for the whole flow (wall-clock seconds, default: no limit)" << endl;
     cout << "  -maxGreedyIter <uint> Maximum greedy iterations" << endl;
+    cout << "  -threads <uint>       Number of threads (default: all cores)" << endl;
+    cout << "  -noCache              Do not read or write the binary design cache" << endl;
+    cout << "  -checkpoint <file>    Save the routing state to <file> after each stage" << endl;
+    cout << "  -checkpointEvery <n>  Also save it every <n> RRR iterations (default: 1)" << endl;
+    cout << "  -resume <file>        Continue from a checkpoint saved for the same design" << endl;
+    cout << "  -snapshot <prefix>    Save per-layer congestion maps after each iteration" << endl;
+    cout << "  -snapshotSize <uint>  Downsample congestion maps to this size (default: 1024)" << endl;
+    cout << "  -warm <file>          Start from the routes in this solution instead of initial routing" << endl;
+    cout << "  -ecoSolution <file>   Reroute only what -ecoDelta changes in this solution" << endl;
+    cout << "  -ecoDelta <file>      Nets added, removed or moved and capacity changes for -ecoSolution" << endl;
     cout << "  -h, -help             Show this page" << endl;
     cout << "Must provide option marked by *" << endl;
     cout << endl;
@@ -360,11 +615,27 @@ void SimpleGRParams::setDefault(void)
 {
     layerAssign = true;
     verbose = false;
+    useCache = true;
     maxRipIter = 20;
     maxGreedyIter = 1;
+    stallIter = 3;
+    coarsen = 0;
+    tileSize = 0;
+    rudy = false;
+    astar = false;
+    numThreads = max(1U, thread::hardware_concurrency());
+    checkpointInterval = 1;
+    snapshotSize = 1024;
     timeOut = 60. * 5;// 5 mins
+    budget = 0.;
     outputFile = "";
     inputFile = "";
+    checkpointFile = "";
+    resumeFile = "";
+    snapshotPrefix = "";
+    warmFile = "";
+    ecoSolutionFile = "";
+    ecoDeltaFile = "";
 }
 
 void SimpleGRParams::print(void) const
@@ -372,8 +643,23 @@ void SimpleGRParams::print(void) const
     cout << endl << "SimpleGR parameters:" << endl;
     cout << "Design file to read:       " << inputFile << endl;
     cout << "Maximum RRR iterations:    " << maxRipIter << endl;
+    if (stallIter > 0) { cout << "RRR iterations w/o progress: " << stallIter << endl; }
+    if (astar) { cout << "RRR A* searches:           on" << endl; }
+    if (coarsen > 1) { cout << "Coarse tiles:              " << coarsen << " x " << coarsen << " gcells" << endl; }
+    if (tileSize > 1) { cout << "GCell numbering tiles:     " << tileSize << " x " << tileSize << " gcells" << endl; }
+    if (rudy) { cout << "Congestion estimate:       on" << endl; }
     cout << "Max RRR runtime:           " << timeOut << " seconds" << endl;
+    if (budget > 0.) { cout << "Time budget:               " << budget << " seconds" << endl; }
     cout << "Maximum greedy iterations: " << maxGreedyIter << endl;
+    cout << "Number of threads:         " << numThreads << endl;
+    if (!checkpointFile.empty()) { cout << "Save checkpoints to:       '" << checkpointFile << "'" << endl; }
+    if (!resumeFile.empty()) { cout << "Resume from checkpoint:    '" << resumeFile << "'" << endl; }
+    if (!snapshotPrefix.empty()) { cout << "Save congestion maps to:   '" << snapshotPrefix << ".*'" << endl; }
+    if (!warmFile.empty()) { cout << "Start from solution:       '" << warmFile << "'" << endl; }
+    if (!ecoDeltaFile.empty()) {
+        cout << "ECO of solution:           '" << ecoSolutionFile << "'" << endl;
+        cout << "ECO changes:               '" << ecoDeltaFile << "'" << endl;
+    }
     if (!outputFile.empty()) {
         cout << "Save solution to file:     '" << outputFile << "'" << endl;
     } else {
@@ -413,6 +699,35 @@ SimpleGRParams::SimpleGRParams(int argc, char **argv)
                 cout << "option -maxRipIter requires an argument" << endl;
                 usage(argv[0]);
             }
+        } else if (argv[i] == string("-stallIter")) {
+            if (i + 1 < argc) {
+                stallIter = static_cast<unsigned>(atoi(argv[++i]));
+            } else {
+                cout << "option -stallIter requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-coarsen")) {
+            if (i + 1 < argc) {
+                coarsen = static_cast<unsigned>(atoi(argv[++i]));
+            } else {
+                cout << "option -coarsen requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-tile")) {
+            if (i + 1 < argc) {
+                tileSize = static_cast<unsigned>(atoi(argv[++i]));
+                if ((tileSize & (tileSize - 1)) != 0) {
+                    cout << "option -tile requires a power of 2" << endl;
+                    usage(argv[0]);
+                }
+            } else {
+                cout << "option -tile requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-rudy")) {
+            rudy = true;
+        } else if (argv[i] == string("-astar")) {
+            astar = true;
         } else if (argv[i] == string("-maxGreedyIter")) {
             if (i + 1 < argc) {
                 maxGreedyIter = static_cast<unsigned>(atoi(argv[++i]));
@@ -420,6 +735,78 @@ SimpleGRParams::SimpleGRParams(int argc, char **argv)
                 cout << "option -maxGreedyIter requires an argument" << endl;
                 usage(argv[0]);
             }
+        } else if (argv[i] == string("-checkpoint")) {
+            if (i + 1 < argc) {
+                checkpointFile = argv[++i];
+            } else {
+                cout << "option -checkpoint requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-checkpointEvery")) {
+            if (i + 1 < argc) {
+                checkpointInterval = static_cast<unsigned>(atoi(argv[++i]));
+            } else {
+                cout << "option -checkpointEvery requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-resume")) {
+            if (i + 1 < argc) {
+                resumeFile = argv[++i];
+            } else {
+                cout << "option -resume requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-snapshot")) {
+            if (i + 1 < argc) {
+                snapshotPrefix = argv[++i];
+            } else {
+                cout << "option -snapshot requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-snapshotSize")) {
+            if (i + 1 < argc) {
+                snapshotSize = max(1U, static_cast<unsigned>(atoi(argv[++i])));
+            } else {
+                cout << "option -snapshotSize requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-warm")) {
+            if (i + 1 < argc) {
+                warmFile = argv[++i];
+            } else {
+                cout << "option -warm requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-ecoSolution")) {
+            if (i + 1 < argc) {
+                ecoSolutionFile = argv[++i];
+            } else {
+                cout << "option -ecoSolution requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-ecoDelta")) {
+            if (i + 1 < argc) {
+                ecoDeltaFile = argv[++i];
+            } else {
+                cout << "option -ecoDelta requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-noCache")) {
+            useCache = false;
+        } else if (argv[i] == string("-threads")) {
+            if (i + 1 < argc) {
+                numThreads = max(1U, static_cast<unsigned>(atoi(argv[++i])));
+            } else {
+                cout << "option -threads requires an argument" << endl;
+                usage(argv[0]);
+            }
+        } else if (argv[i] == string("-budget")) {
+            if (i + 1 < argc) {
+                budget = atof(argv[++i]);
+            } else {
+                cout << "option -budget requires an argument" << endl;
+                usage(argv[0]);
+            }
         } else if (argv[i] == string("-timeOut")) {
             if (i + 1 < argc) {
                 timeOut = atof(argv[++i]);
@@ -437,6 +824,14 @@ SimpleGRParams::SimpleGRParams(int argc, char **argv)
         cout << "Must provide '-f' option" << endl;
         usage(argv[0]);
     }
+    if (ecoSolutionFile.empty() != ecoDeltaFile.empty()) {
+        cout << "Options -ecoSolution and -ecoDelta go together" << endl;
+        usage(argv[0]);
+    }
+    if ((!ecoDeltaFile.empty()) + (!warmFile.empty()) + (!resumeFile.empty()) > 1) {
+        cout << "Options -ecoDelta, -warm and -resume cannot be combined" << endl;
+        usage(argv[0]);
+    }
 }
 
 //@brief: a simple implementation to report progress of routing
@@ -0,0 +1,164 @@
+/*
+ * Verify.cpp
+ * Connectivity and legality check of the committed routes. The mapper runs it
+ * on solution files with -verify, warm starts and ECOs on the routes they load.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "SimpleGR.h"
+
+namespace {
+// problems found in the route of one net
+enum RouteProblem : uint8_t { RouteOpen = 1, RouteDangling = 2, RouteIllegal = 4 };
+
+// Union-find over the gcells of one route. Gcells are numbered by their rank
+// among the sorted gcell ids of the route, so the buffers only grow to the size
+// of the largest route and are reused from net to net.
+struct RouteGraph
+{
+    vector<IdType> edges, gcells;
+    vector<uint32_t> parent, degree;
+
+    uint32_t index(IdType gcellId) const
+    {
+        return static_cast<uint32_t>(lower_bound(gcells.begin(), gcells.end(), gcellId) - gcells.begin());
+    }
+    bool contains(IdType gcellId) const { return binary_search(gcells.begin(), gcells.end(), gcellId); }
+    uint32_t root(uint32_t a)
+    {
+        while (parent[a] != a) {
+            parent[a] = parent[parent[a]];
+            a = parent[a];
+        }
+        return a;
+    }
+};
+}// namespace
+
+struct SimpleGR::RouteCheck
+{
+    uint8_t problems;
+    uint32_t dangling;// route ends that are not pins
+    uint32_t illegal;// edges blocked by a capacity adjustment
+};
+
+//@brief: check that the route of every net connects its two pins, has no
+//        dangling segments, and uses no edge whose capacity was adjusted to 0.
+//        Nets are checked by params.numThreads threads, checks[i] gets the
+//        problems of net i.
+void SimpleGR::checkRoutes(vector<RouteCheck> &checks) const
+{
+    checks.resize(grNetArr.size());
+    auto gcellId = [this](const GCell *gcell) { return gcellCoordToId(gcell->x, gcell->y, gcell->z); };
+
+    auto checkNet = [&](const Net &net, RouteGraph &graph) {
+        RouteCheck &check = checks[net.id];
+        check = { 0, 0, 0 };
+
+        graph.edges.clear();
+        routeEdges(net, graph.edges);
+        graph.gcells.clear();
+        for (IdType edgeId : graph.edges) {
+            const Edge &edge = grEdgeArr[edgeId];
+            graph.gcells.push_back(gcellId(edge.gcell1));
+            graph.gcells.push_back(gcellId(edge.gcell2));
+            // only edges adjusted to 0 have no capacity, see applyCapacityAdjustments
+            if (edge.type != VIA && edge.capacity == 0) ++check.illegal;
+        }
+        sort(graph.gcells.begin(), graph.gcells.end());
+        graph.gcells.erase(unique(graph.gcells.begin(), graph.gcells.end()), graph.gcells.end());
+
+        graph.parent.resize(graph.gcells.size());
+        graph.degree.assign(graph.gcells.size(), 0);
+        for (uint32_t i = 0; i < graph.parent.size(); ++i) graph.parent[i] = i;
+        for (IdType edgeId : graph.edges) {
+            const Edge &edge = grEdgeArr[edgeId];
+            const uint32_t a = graph.index(gcellId(edge.gcell1)), b = graph.index(gcellId(edge.gcell2));
+            ++graph.degree[a];
+            ++graph.degree[b];
+            graph.parent[graph.root(a)] = graph.root(b);
+        }
+
+        const IdType pinOne = gcellCoordToId(net.gCellOne.x, net.gCellOne.y, net.gCellOne.z);
+        const IdType pinTwo = gcellCoordToId(net.gCellTwo.x, net.gCellTwo.y, net.gCellTwo.z);
+        if (!graph.contains(pinOne) || !graph.contains(pinTwo)
+            || graph.root(graph.index(pinOne)) != graph.root(graph.index(pinTwo))) {
+            check.problems |= RouteOpen;
+        }
+        for (uint32_t i = 0; i < graph.gcells.size(); ++i) {
+            if (graph.degree[i] == 1 && graph.gcells[i] != pinOne && graph.gcells[i] != pinTwo) ++check.dangling;
+        }
+        if (check.dangling > 0) check.problems |= RouteDangling;
+        if (check.illegal > 0) check.problems |= RouteIllegal;
+    };
+
+    // threads take blocks of nets, routes differ too much in size for a static split
+    const size_t blockSize = 1024;
+    atomic<size_t> nextBlock(0);
+    auto worker = [&]() {
+        RouteGraph graph;
+        for (size_t first = nextBlock++ * blockSize; first < grNetArr.size(); first = nextBlock++ * blockSize) {
+            const size_t last = min(first + blockSize, grNetArr.size());
+            for (size_t i = first; i < last; ++i) checkNet(grNetArr[i], graph);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned i = 1; i < params.numThreads; ++i) workers.emplace_back(worker);
+    worker();
+    for (thread &t : workers) t.join();
+}
+
+//@brief: rip up the routed nets whose routes fail checkRoutes, such as the
+//        routes of a solution file that lists only some segments of a net
+//@ret:   the ids of the ripped up nets
+vector<IdType> SimpleGR::ripUpBrokenRoutes(void)
+{
+    vector<RouteCheck> checks;
+    checkRoutes(checks);
+    vector<IdType> ripped;
+    for (const Net &net : grNetArr) {
+        if (!net.routed || checks[net.id].problems == 0) continue;
+        ripUpNet(net.id);
+        ripped.push_back(net.id);
+    }
+    return ripped;
+}
+
+//@brief: report the problems checkRoutes finds, in net id order
+//@ret:   true if all routes are fine
+bool SimpleGR::verifyRoutes(void) const
+{
+    const size_t maxListed = 10;
+
+    vector<RouteCheck> checks;
+    checkRoutes(checks);
+
+    size_t openNets = 0, danglingNets = 0, illegalNets = 0, danglingEnds = 0, illegalEdges = 0, listed = 0;
+    cout << endl << "Route verification :" << endl;
+    for (const RouteCheck &check : checks) {
+        if (check.problems == 0) continue;
+        const IdType netId = static_cast<IdType>(&check - &checks[0]);
+        openNets += (check.problems & RouteOpen) != 0;
+        danglingNets += (check.problems & RouteDangling) != 0;
+        illegalNets += (check.problems & RouteIllegal) != 0;
+        danglingEnds += check.dangling;
+        illegalEdges += check.illegal;
+        if (listed++ < maxListed) {
+            cout << " net `" << netNameArr[netId] << "':";
+            if (check.problems & RouteOpen) cout << " open";
+            if (check.dangling > 0) cout << " " << check.dangling << " dangling end(s)";
+            if (check.illegal > 0) cout << " " << check.illegal << " blocked edge(s)";
+            cout << endl;
+        }
+    }
+    if (listed > maxListed) cout << " ... and " << listed - maxListed << " more net(s)" << endl;
+    cout << " open nets " << openNets << endl;
+    cout << " nets with dangling segments " << danglingNets << " (" << danglingEnds << " dangling ends)" << endl;
+    cout << " nets using blocked edges " << illegalNets << " (" << illegalEdges << " edges)" << endl;
+    cout << (listed == 0 ? " verification passed" : " verification FAILED") << endl;
+    return listed == 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * batch.cpp
+ * Routes many designs in one process. Every line of the job file holds the
+ * options of one SimpleGR run; a fixed pool of workers takes the jobs in turn,
+ * so process startup is paid once and the workers' allocator arenas stay warm
+ * from one design to the next.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SimpleGR.h"
+
+namespace {
+// Stream buffer installed in cout. What a worker writes goes to the log of the
+// job it runs; other threads, such as the ones the router starts itself, write
+// to the terminal.
+class JobLogBuf : public std::streambuf
+{
+  public:
+    explicit JobLogBuf(std::streambuf *terminal) : terminal_(terminal) {}
+
+    static thread_local std::streambuf *jobLog;
+
+  protected:
+    int overflow(int c) override
+    {
+        if (c == traits_type::eof()) return traits_type::not_eof(c);
+        const char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        if (jobLog != NULL) return jobLog->sputn(s, n);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return terminal_->sputn(s, n);
+    }
+    int sync() override
+    {
+        if (jobLog != NULL) return jobLog->pubsync();
+        std::lock_guard<std::mutex> lock(mutex_);
+        return terminal_->pubsync();
+    }
+
+  private:
+    std::streambuf *terminal_;
+    std::mutex mutex_;
+};
+
+thread_local std::streambuf *JobLogBuf::jobLog = NULL;
+
+struct Job
+{
+    SimpleGRParams params;
+    string logFile;
+};
+
+void usage(const char *exename)
+{
+    cout << "Usage: " << exename << " <jobfile> [options]" << endl;
+    cout << "Each line of <jobfile> holds the options of one SimpleGR run, for example" << endl;
+    cout << "  -f design.gr -o design.out -maxRipIter 10" << endl;
+    cout << "Empty lines and lines starting with # are skipped. The log of a run is" << endl;
+    cout << "saved next to its solution, or next to its design without -o." << endl;
+    cout << "Available options:" << endl;
+    cout << "  -jobs <uint>          Number of designs routed at the same time (default: 1)" << endl;
+    cout << "  -threads <uint>       Number of threads, shared by the jobs (default: all cores)" << endl;
+    cout << endl;
+    exit(0);
+}
+
+// Reads the job file; a line with invalid options ends the program before any
+// design is routed.
+vector<Job> readJobs(const char *filename, const char *exename)
+{
+    ifstream file(filename);
+    if (!file) {
+        cout << "Error: Could not open `" << filename << "' for reading" << endl;
+        exit(1);
+    }
+
+    vector<Job> jobs;
+    string text;
+    for (unsigned line = 1; getline(file, text); ++line) {
+        istringstream words(text);
+        vector<string> args(1, exename);
+        for (string word; words >> word;) args.push_back(word);
+        if (args.size() == 1 || args[1][0] == '#') continue;
+
+        vector<char *> argv;
+        for (string &arg : args) argv.push_back(&arg[0]);
+        argv.push_back(NULL);
+
+        cout << "job " << jobs.size() + 1 << " (line " << line << "): " << text << endl;
+        Job job = { SimpleGRParams(static_cast<int>(args.size()), argv.data()), "" };
+        job.logFile = (job.params.outputFile.empty() ? job.params.inputFile : job.params.outputFile) + ".log";
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+}// namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) { usage(argv[0]); }
+
+    unsigned numJobs = 1, numThreads = max(1U, thread::hardware_concurrency());
+    for (int i = 2; i < argc; ++i) {
+        if (argv[i] == string("-h") || argv[i] == string("-help")) {
+            usage(argv[0]);
+        } else if (argv[i] == string("-jobs") && i + 1 < argc) {
+            numJobs = static_cast<unsigned>(max(1, atoi(argv[++i])));
+        } else if (argv[i] == string("-threads") && i + 1 < argc) {
+            numThreads = static_cast<unsigned>(max(1, atoi(argv[++i])));
+        } else {
+            cout << "Unknown or incomplete option " << argv[i] << endl;
+            usage(argv[0]);
+        }
+    }
+
+    cout << "SimpleGR " << SimpleGRversion << " batch" << endl << endl;
+    vector<Job> jobs = readJobs(argv[1], argv[0]);
+    numJobs = max(1U, min(numJobs, static_cast<unsigned>(jobs.size())));
+    // the threads of a router parse and write files, they share the cores as well
+    const unsigned threadsPerJob = max(1U, numThreads / numJobs);
+    cout << endl << jobs.size() << " job(s), " << numJobs << " at a time" << endl;
+
+    JobLogBuf logBuf(cout.rdbuf());
+    std::streambuf *terminal = cout.rdbuf(&logBuf);
+
+    using Clock = chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    atomic<size_t> nextJob(0);
+    atomic<unsigned> failed(0);
+    auto worker = [&]() {
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            Job &job = jobs[i];
+            job.params.numThreads = min(job.params.numThreads, threadsPerJob);
+
+            const Clock::time_point jobStart = Clock::now();
+            filebuf log;
+            string error;
+            if (log.open(job.logFile, ios::out | ios::trunc) != NULL) {
+                JobLogBuf::jobLog = &log;
+                // a design that cannot be read ends its own job only
+                try {
+                    SimpleGR simplegr(job.params);
+                    simplegr.run();
+                } catch (const InputError &e) {
+                    error = e.what();
+                    cout << error << endl;
+                }
+                cout << flush;
+                JobLogBuf::jobLog = NULL;
+            }
+            if (!log.is_open() || !error.empty()) { ++failed; }
+
+            const double seconds = chrono::duration<double>(Clock::now() - jobStart).count();
+            if (!log.is_open()) {
+                cout << "job " << i + 1 << ": could not open `" << job.logFile << "' for writing, skipped" << endl;
+            } else if (!error.empty()) {
+                cout << "job " << i + 1 << " `" << job.params.inputFile << "' failed after " << seconds
+                     << " seconds: " << error << endl;
+            } else {
+                cout << "job " << i + 1 << " `" << job.params.inputFile << "' done in " << seconds
+                     << " seconds, log in `" << job.logFile << "'" << endl;
+            }
+        }
+    };
+    vector<thread> workers;
+    for (unsigned i = 1; i < numJobs; ++i) workers.emplace_back(worker);
+    worker();
+    for (thread &t : workers) t.join();
+
+    cout << "all jobs done in " << chrono::duration<double>(Clock::now() - start).count() << " seconds";
+    if (failed > 0) { cout << ", " << failed << " failed"; }
+    cout << endl;
+    cout.rdbuf(terminal);
+    return failed > 0 ? 1 : 0;
+}
@@ -19,22 +19,13 @@ int main(int argc, char **argv)
     // instantiate an instance of SimpleGR
     SimpleGR simplegr(params);
 
-    // read in the nets and create the grid input file
-    simplegr.parseInput();
-    simplegr.printParams();
-
-    // perform 3-stage global routing
-    simplegr.initialRouting();
-    simplegr.printStatistics();
-
-    simplegr.doRRR();
-    simplegr.printStatistics();
-
-    simplegr.greedyImprovement();
-    simplegr.printStatistics(true, true);
-
-    // output solution file
-    simplegr.writeRoutes();
+    // read, route and save the design
+    try {
+        simplegr.run();
+    } catch (const InputError &error) {
+        cout << error.what() << endl;
+        return 1;
+    }
 
     return 0;
 }
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -12,6 +13,9 @@ void usage(const char *exename)
     cout << "Usage: " << exename << " <benchname> <solnname> [options]" << endl;
     cout << "Available options:" << endl;
     cout << "  -o <filename>         Save using base <filename>" << endl;
+    cout << "  -noCache              Do not read or write the binary design cache" << endl;
+    cout << "  -verify               Check that every route connects its pins, exit with 1 if not" << endl;
+    cout << "  -threads <uint>       Number of threads (default: all cores)" << endl;
     cout << endl;
 }
 
@@ -23,6 +27,8 @@ int main(int argc, char **argv)
     }
 
     string outputName = "congestion";
+    SimpleGRParams parms;
+    bool verify = false;
 
     for (int i = 3; i < argc; ++i) {
         if (argv[i] == string("-h") || argv[i] == string("-help")) {
@@ -38,19 +44,35 @@ int main(int argc, char **argv)
                 return 0;
             }
         }
+        if (argv[i] == string("-noCache")) { parms.useCache = false; }
+        if (argv[i] == string("-verify")) { verify = true; }
+        if (argv[i] == string("-threads")) {
+            if (i + 1 < argc) {
+                parms.numThreads = max(1U, static_cast<unsigned>(atoi(argv[i + 1])));
+            } else {
+                cout << "option -threads requires an argument" << endl;
+                usage(argv[0]);
+                return 0;
+            }
+        }
     }
 
-    SimpleGRParams parms;
     SimpleGR simplegr(parms);
 
-    simplegr.parseInputMapper(argv[1]);
-
-    simplegr.parseSolution(argv[2]);
+    try {
+        simplegr.parseInputMapper(argv[1]);
+        simplegr.parseSolution(argv[2]);
+    } catch (const InputError &error) {
+        cout << error.what() << endl;
+        return 1;
+    }
 
     bool noCheckRouted = false;
     simplegr.printStatistics(noCheckRouted);
 
     simplegr.plotXPM(outputName);
 
+    if (verify && !simplegr.verifyRoutes()) return 1;
+
     return 0;
 }